@@ -0,0 +1,94 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/needle/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+/*!\brief A count-min sketch with 8 bit counters, which estimates how often a minimiser occurred.
+ * \details The sketch has a fixed size, independent of the number of distinct minimisers. Estimates are never smaller
+ *          than the true count. Counters are increased by a conservative update, i.e. only the counters equal to the
+ *          current estimate are increased, which keeps the overestimation small. Counters saturate at 255.
+ */
+class count_min_sketch
+{
+private:
+    static constexpr size_t depth{4};
+    // Odd multipliers for multiply-shift hashing, one per row.
+    static constexpr std::array<uint64_t, depth> multipliers{0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL,
+                                                             0x165667B19E3779F9ULL, 0xD6E8FEB86659FD93ULL};
+
+    std::vector<uint8_t> counters{};
+    size_t width{0};
+    int shift{64};
+
+    std::array<size_t, depth> positions(uint64_t const minHash) const noexcept
+    {
+        std::array<size_t, depth> pos{};
+        for (size_t r = 0; r < depth; ++r)
+            pos[r] = r * width + ((minHash * multipliers[r]) >> shift);
+        return pos;
+    }
+
+public:
+    count_min_sketch() = default;
+
+    /*!\brief Creates a sketch that uses at most the given number of bytes.
+     * \param bytes The memory budget, the width of one row is the largest power of two that fits into bytes/4.
+     */
+    explicit count_min_sketch(size_t const bytes)
+    {
+        width = std::bit_floor(std::max<size_t>(bytes / depth, 2));
+        shift = 64 - std::countr_zero(width);
+        counters.assign(depth * width, 0);
+    }
+
+    //!\brief Returns the estimated count of minHash.
+    uint8_t estimate(uint64_t const minHash) const noexcept
+    {
+        uint8_t est{255};
+        for (size_t p : positions(minHash))
+            est = std::min(est, counters[p]);
+        return est;
+    }
+
+    //!\brief Increases the count of minHash by one and returns the estimate before the increment.
+    uint8_t increment(uint64_t const minHash) noexcept
+    {
+        auto const pos = positions(minHash);
+        uint8_t est{255};
+        for (size_t p : pos)
+            est = std::min(est, counters[p]);
+
+        if (est < 255)
+        {
+            for (size_t p : pos)
+                counters[p] = std::max<uint8_t>(counters[p], est + 1);
+        }
+        return est;
+    }
+
+    /*!\brief Increases the count of minHash by one and checks, if its estimate passes the cutoff.
+     * \returns 0, if the estimate before the increment is smaller than the cutoff. Otherwise the estimate including
+     *          the current occurrence, which is not smaller than the true count of minHash so far.
+     */
+    uint16_t increment_above(uint64_t const minHash, uint8_t const cutoff) noexcept
+    {
+        uint8_t const est = increment(minHash);
+        return (est >= cutoff) ? est + 1u : 0u;
+    }
+
+    //!\brief Size of the sketch in bytes.
+    size_t size_in_bytes() const noexcept
+    {
+        return counters.size();
+    }
+};
@@ -0,0 +1,415 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/needle/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*!\brief A hash table mapping minimiser hashes to counts, which stores keys and counts in two flat arrays.
+ * \tparam count_t The type of the counts, uint16_t for the minimiser counts and uint8_t for the cutoff table.
+ * \details Collisions are resolved by linear probing, so a lookup scans consecutive keys in one array. Compared to a
+ *          node based map no memory is allocated per minimiser, one slot needs sizeof(uint64_t) + sizeof(count_t) bytes.
+ *          The largest uint64_t marks empty slots, if it is used as a key it is stored in an extra slot at the end.
+ */
+template <typename count_t>
+class flat_counter_table
+{
+private:
+    static constexpr uint64_t empty_key{std::numeric_limits<uint64_t>::max()};
+    static constexpr size_t min_capacity{16};
+
+    std::vector<uint64_t> keys{};  // capacity slots followed by the slot for the empty_key
+    std::vector<count_t> counts{};
+    size_t elements{0};
+    size_t mask{0};                // capacity - 1
+    int shift{64};                 // 64 - log2(capacity)
+    bool has_empty_key{false};
+
+    // Fibonacci hashing, minimisers are small values, so their low bits alone are a bad bucket index.
+    size_t bucket(uint64_t const key) const noexcept
+    {
+        return (key * 0x9E3779B97F4A7C15ULL) >> shift;
+    }
+
+    size_t capacity() const noexcept
+    {
+        return keys.empty() ? 0 : mask + 1;
+    }
+
+    bool occupied(size_t const i) const noexcept
+    {
+        return (i < capacity()) ? (keys[i] != empty_key) : has_empty_key;
+    }
+
+    // Position of key or of the empty slot where it would be inserted.
+    size_t probe(uint64_t const key) const noexcept
+    {
+        size_t i = bucket(key);
+        while ((keys[i] != key) & (keys[i] != empty_key))
+            i = (i + 1) & mask;
+        return i;
+    }
+
+    void rehash(size_t const new_capacity)
+    {
+        std::vector<uint64_t> old_keys(new_capacity + 1, empty_key);
+        std::vector<count_t> old_counts(new_capacity + 1, 0);
+        old_keys.swap(keys);
+        old_counts.swap(counts);
+        size_t const old_capacity = old_keys.empty() ? 0 : old_keys.size() - 1;
+        mask = new_capacity - 1;
+        shift = 64 - std::countr_zero(new_capacity);
+
+        for (size_t i = 0; i < old_capacity; ++i)
+        {
+            if (old_keys[i] != empty_key)
+            {
+                size_t const pos = probe(old_keys[i]);
+                keys[pos] = old_keys[i];
+                counts[pos] = old_counts[i];
+            }
+        }
+        if (!old_keys.empty())
+            counts[new_capacity] = old_counts[old_capacity];
+    }
+
+    // Sort the entries in [first, last) by their keys, which are equal above the byte starting at bit shift. The entries
+    // are distributed in place by this byte into 256 buckets, which are sorted by the next byte.
+    void sort_entries(size_t const first, size_t const last, int const shift)
+    {
+        if (last - first <= 32)
+        {
+            for (size_t i = first + 1; i < last; ++i)
+            {
+                uint64_t const key = keys[i];
+                count_t const count = counts[i];
+                size_t j = i;
+                for (; (j > first) && (keys[j - 1] > key); --j)
+                {
+                    keys[j] = keys[j - 1];
+                    counts[j] = counts[j - 1];
+                }
+                keys[j] = key;
+                counts[j] = count;
+            }
+            return;
+        }
+
+        std::array<size_t, 257> bucket_begin{};
+        for (size_t i = first; i < last; ++i)
+            ++bucket_begin[((keys[i] >> shift) & 255) + 1];
+        bucket_begin[0] = first;
+        for (size_t b = 1; b < bucket_begin.size(); ++b)
+            bucket_begin[b] += bucket_begin[b - 1];
+
+        // Every entry is swapped to the next free position of its bucket, until the entry at next[b] belongs to b.
+        std::array<size_t, 256> next{};
+        std::copy(bucket_begin.begin(), bucket_begin.end() - 1, next.begin());
+        for (size_t b = 0; b < next.size(); ++b)
+        {
+            while (next[b] < bucket_begin[b + 1])
+            {
+                size_t const d = (keys[next[b]] >> shift) & 255;
+                if (d == b)
+                {
+                    ++next[b];
+                }
+                else
+                {
+                    std::swap(keys[next[b]], keys[next[d]]);
+                    std::swap(counts[next[b]], counts[next[d]]);
+                    ++next[d];
+                }
+            }
+        }
+
+        if (shift > 0)
+        {
+            for (size_t b = 0; b < next.size(); ++b)
+                sort_entries(bucket_begin[b], bucket_begin[b + 1], shift - 8);
+        }
+    }
+
+    // Grow, if inserting one more element would exceed a load factor of 3/4.
+    void grow_if_needed()
+    {
+        if (keys.empty())
+            rehash(min_capacity);
+        else if (4 * (elements + 1) > 3 * capacity())
+            rehash(2 * capacity());
+    }
+
+public:
+    //!\brief Proxy for one entry, gives access in the same way as std::pair for a map.
+    struct reference
+    {
+        uint64_t const first;
+        count_t & second;
+    };
+
+    //!\brief Forward iterator over all stored entries.
+    template <bool is_const>
+    class iterator_type
+    {
+    private:
+        using table_t = std::conditional_t<is_const, flat_counter_table const, flat_counter_table>;
+        table_t * table{nullptr};
+        size_t pos{0};
+
+        void skip_empty() noexcept
+        {
+            while ((pos <= table->capacity()) && !table->occupied(pos))
+                ++pos;
+        }
+
+        friend flat_counter_table;
+
+    public:
+        using difference_type = std::ptrdiff_t;
+        using value_type = std::pair<uint64_t, count_t>;
+        using iterator_category = std::forward_iterator_tag;
+        using reference = std::conditional_t<is_const, std::pair<uint64_t, count_t>, flat_counter_table::reference>;
+
+        struct pointer
+        {
+            reference ref;
+            reference * operator->() noexcept { return &ref; }
+        };
+
+        iterator_type() = default;
+        iterator_type(table_t * t, size_t const p, bool const skip = true) noexcept : table{t}, pos{p}
+        {
+            if (skip)
+                skip_empty();
+        }
+
+        reference operator*() const noexcept
+        {
+            return {table->keys[pos], table->counts[pos]};
+        }
+
+        pointer operator->() const noexcept
+        {
+            return {**this};
+        }
+
+        iterator_type & operator++() noexcept
+        {
+            ++pos;
+            skip_empty();
+            return *this;
+        }
+
+        iterator_type operator++(int) noexcept
+        {
+            iterator_type tmp{*this};
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(iterator_type const & rhs) const noexcept
+        {
+            return pos == rhs.pos;
+        }
+    };
+
+    using iterator = iterator_type<false>;
+    using const_iterator = iterator_type<true>;
+
+    flat_counter_table() = default;
+
+    //!\brief Number of stored minimisers.
+    size_t size() const noexcept
+    {
+        return elements + has_empty_key;
+    }
+
+    bool empty() const noexcept
+    {
+        return size() == 0;
+    }
+
+    //!\brief Allocate enough slots for n minimisers.
+    void reserve(size_t const n)
+    {
+        size_t const needed = std::bit_ceil(std::max<size_t>(min_capacity, (4 * n + 2) / 3));
+        if (needed > capacity())
+            rehash(needed);
+    }
+
+    //!\brief Remove all minimisers, the allocated memory is kept.
+    void clear() noexcept
+    {
+        std::fill(keys.begin(), keys.end(), empty_key);
+        std::fill(counts.begin(), counts.end(), 0);
+        elements = 0;
+        has_empty_key = false;
+    }
+
+    //!\brief Returns the count of key, key is inserted with count 0 if it is not stored yet.
+    count_t & operator[](uint64_t const key)
+    {
+        if (key == empty_key) [[unlikely]]
+        {
+            if (keys.empty())
+                rehash(min_capacity);
+            has_empty_key = true;
+            return counts[capacity()];
+        }
+
+        if (!keys.empty())
+        {
+            size_t const pos = probe(key);
+            if (keys[pos] == key)
+                return counts[pos];
+        }
+
+        grow_if_needed();
+        size_t const pos = probe(key);
+        keys[pos] = key;
+        counts[pos] = 0;
+        ++elements;
+        return counts[pos];
+    }
+
+    iterator find(uint64_t const key) noexcept
+    {
+        if (keys.empty())
+            return end();
+        if (key == empty_key) [[unlikely]]
+            return has_empty_key ? iterator{this, capacity(), false} : end();
+        size_t const pos = probe(key);
+        return (keys[pos] == key) ? iterator{this, pos, false} : end();
+    }
+
+    const_iterator find(uint64_t const key) const noexcept
+    {
+        if (keys.empty())
+            return end();
+        if (key == empty_key) [[unlikely]]
+            return has_empty_key ? const_iterator{this, capacity(), false} : end();
+        size_t const pos = probe(key);
+        return (keys[pos] == key) ? const_iterator{this, pos, false} : end();
+    }
+
+    bool contains(uint64_t const key) const noexcept
+    {
+        return find(key) != end();
+    }
+
+    //!\brief Removes the entry at it. Following entries are shifted back, so no tombstones are needed.
+    void erase(iterator it) noexcept
+    {
+        size_t hole = it.pos;
+        if (hole == capacity())
+        {
+            has_empty_key = false;
+            counts[hole] = 0;
+            return;
+        }
+
+        size_t next = hole;
+        while (true)
+        {
+            next = (next + 1) & mask;
+            if (keys[next] == empty_key)
+                break;
+            size_t const home = bucket(keys[next]);
+            // Move the entry into the hole, if its home bucket is not cyclically in (hole, next].
+            bool const stays = (hole <= next) ? ((hole < home) & (home <= next)) : ((hole < home) | (home <= next));
+            if (!stays)
+            {
+                keys[hole] = keys[next];
+                counts[hole] = counts[next];
+                hole = next;
+            }
+        }
+        keys[hole] = empty_key;
+        counts[hole] = 0;
+        --elements;
+    }
+
+    void erase(uint64_t const key) noexcept
+    {
+        auto it = find(key);
+        if (it != end())
+            erase(it);
+    }
+
+    //!\brief Removes all entries for which pred(key, count) is true.
+    template <typename pred_t>
+    void erase_if(pred_t && pred)
+    {
+        // Erasing shifts following entries back into the current slot, so the slot is checked again. Entries that
+        // wrap around to the front are only shifted into slots that were already checked.
+        for (size_t i = 0; i < capacity();)
+        {
+            if ((keys[i] != empty_key) && pred(keys[i], counts[i]))
+                erase(iterator{this, i, false});
+            else
+                ++i;
+        }
+        if (has_empty_key && pred(empty_key, counts[capacity()]))
+            erase(iterator{this, capacity(), false});
+    }
+
+    /*!\brief Calls callback(key, count) for all entries in increasing order of the keys and removes them.
+     * \details The entries are moved to the front of the arrays and sorted there, so no additional memory is needed.
+     */
+    template <typename callback_t>
+    void extract_sorted(callback_t && callback)
+    {
+        size_t number_of_keys{0};
+        uint64_t max_key{0};
+        for (size_t i = 0; i < capacity(); ++i)
+        {
+            if (keys[i] != empty_key)
+            {
+                max_key = std::max(max_key, keys[i]);
+                keys[number_of_keys] = keys[i];
+                counts[number_of_keys] = counts[i];
+                ++number_of_keys;
+            }
+        }
+        // Leading bytes, which are zero for all keys, do not need to be sorted by.
+        sort_entries(0, number_of_keys, std::max<int>(0, (std::bit_width(max_key) - 1) / 8 * 8));
+
+        for (size_t i = 0; i < number_of_keys; ++i)
+            callback(keys[i], counts[i]);
+        if (has_empty_key)
+            callback(empty_key, counts[capacity()]);
+        clear();
+    }
+
+    iterator begin() noexcept
+    {
+        return keys.empty() ? end() : iterator{this, 0};
+    }
+
+    iterator end() noexcept
+    {
+        return {this, capacity() + 1, false};
+    }
+
+    const_iterator begin() const noexcept
+    {
+        return keys.empty() ? end() : const_iterator{this, 0};
+    }
+
+    const_iterator end() const noexcept
+    {
+        return {this, capacity() + 1, false};
+    }
+};
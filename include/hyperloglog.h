@@ -0,0 +1,74 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/needle/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/*!\brief A HyperLogLog sketch, which estimates the number of distinct minimisers added.
+ * \details The sketch has 2^precision registers of one byte, adding a minimiser several times does not change it.
+ *          The relative standard error of the estimate is about 1.04 / sqrt(2^precision), i.e. 0.8% for the default
+ *          precision of 14. Small numbers are estimated by linear counting over the empty registers.
+ */
+class hyperloglog
+{
+private:
+    int precision{14};
+    std::vector<uint8_t> registers{};
+
+    // Minimisers of small k do not use the upper bits, so they are mixed first.
+    static uint64_t mix(uint64_t x) noexcept
+    {
+        x ^= x >> 33;
+        x *= 0xFF51AFD7ED558CCDULL;
+        x ^= x >> 33;
+        x *= 0xC4CEB9FE1A85EC53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+public:
+    /*!\brief Creates an empty sketch.
+     * \param precision_ The number of bits of a hash selecting the register, between 4 and 18.
+     */
+    explicit hyperloglog(int const precision_ = 14) :
+        precision{std::clamp(precision_, 4, 18)},
+        registers(size_t{1} << precision, 0)
+    {}
+
+    void add(uint64_t const minHash) noexcept
+    {
+        uint64_t const hash = mix(minHash);
+        size_t const index = hash >> (64 - precision);
+        // The position of the first set bit of the remaining bits, the marker bit limits it to 64 - precision + 1.
+        uint8_t const rank = std::countl_zero((hash << precision) | (uint64_t{1} << (precision - 1))) + 1;
+        registers[index] = std::max(registers[index], rank);
+    }
+
+    //!\brief Returns the estimated number of distinct minimisers.
+    uint64_t estimate() const noexcept
+    {
+        double const m = registers.size();
+        double sum{0};
+        size_t empty_registers{0};
+        for (uint8_t const rank : registers)
+        {
+            sum += std::ldexp(1.0, -rank);
+            empty_registers += (rank == 0);
+        }
+
+        double const alpha = 0.7213 / (1.0 + 1.079 / m);
+        double const raw_estimate = alpha * m * m / sum;
+        if ((raw_estimate <= 2.5 * m) && (empty_registers > 0))
+            return std::llround(m * std::log(m / empty_registers));
+        return std::llround(raw_estimate);
+    }
+};
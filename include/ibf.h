@@ -16,6 +16,7 @@
 #include <seqan3/alphabet/nucleotide/dna4.hpp>
 #include <filesystem>
 
+#include "flat_counter_table.h"
 #include "shared.h"
 
 struct minimiser_arguments
@@ -25,6 +26,11 @@ struct minimiser_arguments
     std::vector<int> samples{}; // Can be used to indicate that sequence files belong to the same experiment
     bool paired = false; // If true, than experiments are seen as paired-end experiments
     bool experiment_names = false; // Flag, if names of experiment should be stored in a txt file
+    uint64_t sketch_memory{0}; // Memory in MiB for a count-min sketch replacing the cutoff table, 0 means exact counting
+    uint64_t max_memory{0}; // Memory in MiB for counting with temporary files, 0 means counting in memory
+    uint64_t size_sketch_memory{0}; // Memory in MiB for estimating the IBF sizes in an extra pass, 0 means by file size
+    uint64_t checkpoint_interval{0}; // Number of samples after which a checkpoint is written, 0 means no checkpoints
+    bool resume = false; // If true, a build is continued from its last checkpoint
 };
 
 //!\brief Generates a random integer not greater than a given maximum
@@ -55,7 +61,7 @@ void count(min_arguments const & args, std::vector<std::filesystem::path> sequen
 * \param hash_table         The hash table to store minimisers into.
 
 */
-void read_binary(std::filesystem::path filename, robin_hood::unordered_node_map<uint64_t, uint16_t> & hash_table);
+void read_binary(std::filesystem::path filename, flat_counter_table<uint16_t> & hash_table);
 
 /*!\brief Reads the beginning of a binary file that needle minimiser creates.
 * \param args               Min arguments.
@@ -90,12 +96,46 @@ std::vector<uint16_t> ibf(std::vector<std::filesystem::path> const & sequence_fi
  * \param expression_by_genome_file File that contains the only minimisers that should be comnsidered for the
  *                                  determination of the expression_thresholds.
  * \param num_hash        The number of hash functions to use.
+ * \param levels_in_memory The number of IBFs kept in memory at the same time. The minimiser files are read once for
+ *                         every group of levels. 0 means all IBFs are built at once.
  *  \returns The expression thresholds per experiment.
  */
 std::vector<uint16_t> ibf(std::vector<std::filesystem::path> const & minimiser_files,
                           estimate_ibf_arguments & ibf_args, std::vector<double> & fpr,
                           std::filesystem::path const expression_by_genome_file = "",
-                          size_t num_hash = 1);
+                          size_t num_hash = 1, uint8_t const levels_in_memory = 0);
+
+/*! \brief Appends experiments to an existing index, without rebuilding the bins already stored. The IBFs of a
+ *         compressed index are decompressed and compressed again.
+ * \param minimiser_files The minimiser files of the new experiments, created with the minimiser arguments of the index.
+ * \param ibf_args        The arguments of the index are loaded from its IBF_Data file, path_out has to be the prefix
+ *                        of the index and threads the number of threads to use.
+ *  \returns The expression thresholds of the index.
+ */
+std::vector<uint16_t> append(std::vector<std::filesystem::path> const & minimiser_files,
+                             estimate_ibf_arguments & ibf_args);
+
+/*! \brief Clears a bin of an existing index in all levels and inserts the minimisers of a replacement. The IBFs of a
+ *         compressed index are decompressed and compressed again.
+ * \param bin            The bin to clear, i.e. the position of the experiment in the index.
+ * \param minimiser_file The minimiser file of the replacing experiment. If it is empty, the bin is only cleared.
+ * \param ibf_args       The arguments of the index are loaded from its IBF_Data file, path_out has to be the prefix
+ *                       of the index.
+ *  \returns The expression thresholds of the index.
+ */
+std::vector<uint16_t> replace(size_t const bin, std::filesystem::path const & minimiser_file,
+                              estimate_ibf_arguments & ibf_args);
+
+/*! \brief Merges indexes of disjoint experiments into one index, e.g. indexes built on different machines.
+ *         The bins of the merged index are the bins of the first index followed by the bins of the next ones.
+ * \param indexes  The prefixes of the indexes to merge, which have to be built with the same arguments and bin sizes.
+ *                 Compressed indexes are decompressed.
+ * \param ibf_args The merged index is stored with the prefix path_out, compressed if compressed is set. The other
+ *                 arguments are loaded from the IBF_Data files of the indexes.
+ *  \returns The expression thresholds of the index.
+ */
+std::vector<uint16_t> merge_indexes(std::vector<std::filesystem::path> const & indexes,
+                                    estimate_ibf_arguments & ibf_args);
 
 /*! \brief Create minimiser and header files.
 * \param sequence_files  A vector of sequence file paths.
@@ -105,3 +145,11 @@ std::vector<uint16_t> ibf(std::vector<std::filesystem::path> const & minimiser_f
 */
 void minimiser(std::vector<std::filesystem::path> const & sequence_files, min_arguments const & args,
                minimiser_arguments & minimiser_args, std::vector<uint8_t> & cutoffs);
+
+/*! \brief Merges minimiser files of the same experiment, e.g. of several sequencing runs, into one minimiser file.
+* \param minimiser_files  The minimiser files, which have to be created with the same minimiser arguments.
+* \param output_file      The file to store the merged minimisers in.
+* \param cutoff           Only minimisers occurring more often than cutoff in all files together are stored.
+*/
+void minimiser_merge(std::vector<std::filesystem::path> const & minimiser_files, std::filesystem::path const & output_file,
+                     uint8_t const cutoff = 0);
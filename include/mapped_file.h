@@ -0,0 +1,119 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/needle/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*!\brief A file mapped read-only into memory, the mapping is removed on destruction.
+ * \details If the file can not be opened or mapped, is_open() is false. Empty files are open, but have no data.
+ */
+class mapped_file
+{
+private:
+    char const * data_{nullptr};
+    size_t size_{0};
+    bool open_{false};
+
+    void unmap() noexcept
+    {
+        if (data_ != nullptr)
+            munmap(const_cast<char *>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+        open_ = false;
+    }
+
+public:
+    mapped_file() = default;
+
+    explicit mapped_file(std::filesystem::path const & path)
+    {
+        int const fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) == 0)
+        {
+            size_ = file_stat.st_size;
+            if (size_ == 0)
+            {
+                open_ = true;
+            }
+            else
+            {
+                void * mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapping != MAP_FAILED)
+                {
+                    data_ = static_cast<char const *>(mapping);
+                    open_ = true;
+                }
+                else
+                {
+                    size_ = 0;
+                }
+            }
+        }
+        ::close(fd);
+    }
+
+    mapped_file(mapped_file const &) = delete;
+    mapped_file & operator=(mapped_file const &) = delete;
+
+    mapped_file(mapped_file && other) noexcept :
+        data_{std::exchange(other.data_, nullptr)},
+        size_{std::exchange(other.size_, 0)},
+        open_{std::exchange(other.open_, false)}
+    {}
+
+    mapped_file & operator=(mapped_file && other) noexcept
+    {
+        if (this != &other)
+        {
+            unmap();
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+            open_ = std::exchange(other.open_, false);
+        }
+        return *this;
+    }
+
+    ~mapped_file()
+    {
+        unmap();
+    }
+
+    bool is_open() const noexcept
+    {
+        return open_;
+    }
+
+    char const * data() const noexcept
+    {
+        return data_;
+    }
+
+    size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    //!\brief Gives the kernel a hint how the mapping is going to be accessed, e.g. MADV_SEQUENTIAL.
+    void advise(int const advice) const noexcept
+    {
+        if (data_ != nullptr)
+            madvise(const_cast<char *>(data_), size_, advice);
+    }
+};
@@ -0,0 +1,265 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/needle/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.h"
+#include "shared.h"
+
+/*! \file
+ * \brief Reading and writing the minimiser files created by needle minimiser.
+ * \details Version 1 files consist of the header
+ *          (uint64_t number of minimisers, uint8_t cutoff, uint8_t k, uint32_t window, uint64_t seed, bool ungapped and,
+ *          for gapped shapes, uint64_t shape) followed by unsorted records of a uint64_t minimiser and its uint16_t count.
+ *
+ *          Version 2 files start with a header of 64 bytes, see minimiser_file_v2_header, followed by blocks of at most
+ *          minimiser_file_writer::records_per_block minimisers in increasing order. Every block can be decoded on its
+ *          own: It starts with the number of minimisers (uint32_t), the size of its data in bytes (uint32_t) and its
+ *          first minimiser (uint64_t). The data contains the differences of all following minimisers to their
+ *          predecessor and then the counts of all minimisers of the block, all stored as LEB128 varints.
+ *          If the flag minimiser_file_flags::count_histogram is set, the blocks are followed by the histogram of the
+ *          counts: For every count occurring, the count and the number of minimisers with this count (both uint64_t),
+ *          in increasing order of the counts, and then the number of these pairs (uint64_t).
+ *          If the flag minimiser_file_flags::block_directory is set, the file ends with one minimiser_block_entry per
+ *          block, so the blocks can be found without reading the whole file.
+ *          The flag minimiser_file_flags::incomplete is set until the file is closed, so files of interrupted runs are
+ *          not mistaken for files without minimisers.
+ */
+
+//!\brief The magic number at the beginning of minimiser files since version 2.
+inline constexpr char minimiser_file_magic[8]{'\x89', 'N', 'E', 'E', 'D', 'L', 'E', '\n'};
+
+//!\brief Flags of version 2 minimiser files, which mark optional parts of the file.
+enum minimiser_file_flags : uint32_t
+{
+    block_directory = 1u << 0, //!< A directory of all blocks is stored at the end of the file.
+    count_histogram = 1u << 1, //!< The number of minimisers for every count is stored after the blocks.
+    incomplete = 1u << 31,     //!< The file is still written or writing it was interrupted, it can not be read.
+};
+
+//!\brief The position and first minimiser of a block of a minimiser file.
+struct minimiser_block_entry
+{
+    uint64_t offset;                // Position of the block header in the file
+    uint64_t first_minimiser;
+    uint32_t number_of_minimisers;
+    uint32_t reserved;
+};
+static_assert(sizeof(minimiser_block_entry) == 24);
+
+//!\brief The layout of the header of version 2 minimiser files.
+struct minimiser_file_v2_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;                 // Optional parts of the file, unknown flags are ignored when reading
+    uint64_t number_of_minimisers;
+    uint64_t number_of_blocks;
+    uint64_t blocks_offset;         // Position of the first block, optional parts may be stored before
+    uint64_t seed;
+    uint64_t shape;
+    uint32_t window;
+    uint8_t k;
+    uint8_t cutoff;
+    uint8_t ungapped;
+    uint8_t reserved;
+};
+static_assert(sizeof(minimiser_file_v2_header) == 64);
+
+//!\brief The information stored in the header of a minimiser file, independent of its version.
+struct minimiser_file_header
+{
+    uint32_t version{2};
+    uint32_t flags{0};
+    uint64_t number_of_minimisers{0};
+    uint8_t cutoff{0};
+    uint8_t k{0};
+    uint32_t window{0};
+    uint64_t seed{0};
+    bool ungapped{true};
+    uint64_t shape{0};
+
+    minimiser_file_header() = default;
+
+    //!\brief The header for minimisers calculated with the given arguments and cutoff.
+    minimiser_file_header(min_arguments const & args, uint8_t const cutoff_) :
+        cutoff{cutoff_},
+        k{args.k},
+        window{args.w_size.get()},
+        seed{args.s.get()},
+        ungapped{args.shape.all()},
+        shape{args.shape.to_ulong()}
+    {}
+};
+
+/*!\brief Writes a version 2 minimiser file.
+ * \details The minimisers have to be given in increasing order. The number of minimisers and blocks in the header are
+ *          set by close(), so the number of minimisers does not need to be known beforehand. Until then, the file is
+ *          marked as incomplete.
+ *          Encoded blocks are collected in a buffer of buffer_size bytes. A full buffer is handed to a background thread,
+ *          which writes it to the file, while the next blocks are encoded into a second buffer.
+ */
+class minimiser_file_writer
+{
+public:
+    //!\brief The number of minimisers in a full block.
+    static constexpr size_t records_per_block{4096};
+    //!\brief The size of the buffers, which are written to the file at once.
+    static constexpr size_t buffer_size{size_t{1} << 20};
+
+    minimiser_file_writer(std::filesystem::path const & filename, minimiser_file_header const & header);
+
+    minimiser_file_writer(minimiser_file_writer const &) = delete;
+    minimiser_file_writer & operator=(minimiser_file_writer const &) = delete;
+
+    /*!\brief Closes the file, if close() was not called. Errors are only reported by close().
+     * \details If the writer is destroyed by an exception, the file is not completed and stays marked as incomplete.
+     */
+    ~minimiser_file_writer();
+
+    //!\brief Adds a minimiser, which has to be greater than the last one.
+    void push(uint64_t const minimiser, uint16_t const count)
+    {
+        if ((number_of_minimisers > 0) && (minimiser <= last_minimiser))
+            throw std::invalid_argument{"The minimisers of a minimiser file need to be written in increasing order."};
+        minimisers.push_back(minimiser);
+        counts.push_back(count);
+        ++histogram[count];
+        last_minimiser = minimiser;
+        ++number_of_minimisers;
+        if (minimisers.size() == records_per_block)
+            write_block();
+    }
+
+    //!\brief Writes the last block and completes the header.
+    void close();
+
+private:
+    std::filesystem::path filename;
+    std::ofstream outfile;
+    minimiser_file_v2_header file_header{};
+    std::vector<uint64_t> minimisers{};
+    std::vector<uint16_t> counts{};
+    std::vector<uint8_t> data{};
+    std::vector<char> buffer{};
+    std::vector<char> flush_buffer{};   // Written by flusher, while flush_pending is set
+    std::mutex flush_mutex{};
+    std::condition_variable flush_condition{};
+    bool flush_pending{false};
+    bool stop_flushing{false};
+    std::thread flusher{};
+    std::vector<minimiser_block_entry> directory{};
+    std::vector<uint64_t> histogram = std::vector<uint64_t>(65536, 0);
+    uint64_t last_minimiser{0};
+    uint64_t number_of_minimisers{0};
+    uint64_t offset{sizeof(minimiser_file_v2_header)};
+    int const uncaught_exceptions{std::uncaught_exceptions()};
+
+    void write_block();
+    void append(void const * bytes, size_t const size);
+    void flush();
+    void wait_for_flush();
+    void write_flushed_buffers();
+    void stop_flusher();
+};
+
+/*!\brief Reads version 1 and version 2 minimiser files.
+ * \details The file is mapped into memory and read sequentially, the minimisers are decoded directly from the mapping
+ *          block by block. For version 1 files a block are the next records of the file.
+ *          Blocks can also be read in any order by their number, which is safe from several threads.
+ */
+class minimiser_file_reader
+{
+public:
+    //!\brief Maps the file and reads its header, throws std::runtime_error if this is not possible.
+    explicit minimiser_file_reader(std::filesystem::path const & filename);
+
+    minimiser_file_header const & header() const noexcept
+    {
+        return header_;
+    }
+
+    /*!\brief Reads the histogram of the counts stored in the file.
+     * \param histogram Is set to the number of minimisers for every count, histogram[c] is the number of minimisers
+     *                  occurring c times. The size of the histogram is 65536.
+     * \returns False, if the file contains no histogram. The histogram is not changed then.
+     */
+    bool read_histogram(std::vector<uint64_t> & histogram) const;
+
+    //!\brief The number of blocks, which can be read by read_block(b, minimisers, counts).
+    size_t number_of_blocks() const noexcept
+    {
+        return blocks.size();
+    }
+
+    /*!\brief Reads block b.
+     * \param b          The number of the block, smaller than number_of_blocks().
+     * \param minimisers Is filled with the minimisers of the block, increasing for version 2 files.
+     * \param counts     Is filled with the counts of the minimisers.
+     */
+    void read_block(size_t const b, std::vector<uint64_t> & minimisers, std::vector<uint16_t> & counts) const;
+
+    /*!\brief Reads the next block of minimisers.
+     * \param minimisers Is filled with the minimisers of the block, increasing for version 2 files.
+     * \param counts     Is filled with the counts of the minimisers.
+     * \returns False, if all minimisers have been read.
+     */
+    bool read_block(std::vector<uint64_t> & minimisers, std::vector<uint16_t> & counts)
+    {
+        if (next_block == blocks.size())
+        {
+            minimisers.clear();
+            counts.clear();
+            return false;
+        }
+        // Reading block by block goes from the beginning to the end of the file. Blocks read by their number might be
+        // read in any order by several threads, so the mapping is only advised here.
+        if (next_block == 0)
+            file.advise(MADV_SEQUENTIAL);
+        read_block(next_block++, minimisers, counts);
+        return true;
+    }
+
+    //!\brief Calls callback(minimiser, count) for all remaining minimisers of the file.
+    template <typename callback_t>
+    void for_each(callback_t && callback)
+    {
+        std::vector<uint64_t> minimisers{};
+        std::vector<uint16_t> counts{};
+        while (read_block(minimisers, counts))
+        {
+            for (size_t i = 0; i < minimisers.size(); ++i)
+                callback(minimisers[i], counts[i]);
+        }
+    }
+
+    //!\brief Starts reading at the first minimiser again.
+    void rewind() noexcept
+    {
+        next_block = 0;
+    }
+
+private:
+    std::filesystem::path filename;
+    mapped_file file;
+    minimiser_file_header header_{};
+    std::vector<minimiser_block_entry> blocks{};
+    size_t next_block{0};
+    size_t histogram_end{0};    // Position after the histogram, if the file contains one
+
+    void read_directory(minimiser_file_v2_header const & file_header);
+};
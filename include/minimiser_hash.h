@@ -0,0 +1,24 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/needle/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <vector>
+
+#include <seqan3/alphabet/nucleotide/dna4.hpp>
+
+#include "shared.h"
+
+/*! \brief Calculates the minimisers of a sequence, the result is identical to seqan3::views::minimiser_hash.
+ *  \param args       The minimiser arguments (shape, window size and seed).
+ *  \param seq        The sequence.
+ *  \param minimisers Is cleared and filled with the minimisers of seq. Reusing the vector for several sequences
+ *                    avoids reallocations.
+ *  \details Ungapped shapes, which are used nearly always, are calculated by a rolling hash and a monotone queue for
+ *           the window minimum, which is compiled for every k. Gapped shapes use seqan3::views::minimiser_hash.
+ */
+void compute_minimisers(min_arguments const & args, seqan3::dna4_vector const & seq, std::vector<uint64_t> & minimisers);
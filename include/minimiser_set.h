@@ -0,0 +1,209 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/needle/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "mapped_file.h"
+
+/*!\brief A set of minimisers for the include and exclude files, optimised for many lookups.
+ * \details The minimisers are stored in a sorted array, which can also be a memory mapped file. A lookup first checks a
+ *          blocked Bloom filter, which needs one cache line per minimiser. Only if the minimiser might be contained,
+ *          the sorted array is searched in the small range given by an index over the upper bits of the minimisers.
+ *          filter() checks whole vectors of minimisers and prefetches the Bloom filter blocks of several minimisers
+ *          at once.
+ */
+class minimiser_set
+{
+private:
+    static constexpr size_t bits_per_minimiser{16};
+    static constexpr size_t block_words{8};    // One block is a cache line of 512 bits
+    static constexpr size_t probes{7};         // Bits set per minimiser, 9 bits of a hash select one bit of a block
+    static constexpr size_t batch_size{16};
+
+    std::vector<uint64_t> owned_values{};
+    mapped_file mapping{};
+    std::span<uint64_t const> values{};
+
+    std::vector<uint64_t> bloom{};
+    int block_bits{0};
+    std::vector<uint64_t> index{};     // index[p] is the position of the first minimiser with prefix p
+    int value_shift{0};
+
+    static uint64_t mix(uint64_t x) noexcept
+    {
+        x ^= x >> 33;
+        x *= 0xFF51AFD7ED558CCDULL;
+        x ^= x >> 33;
+        x *= 0xC4CEB9FE1A85EC53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+    // The block is selected by the upper bits of the hash, the bits within the block by a second hash.
+    static uint64_t probe_bits(uint64_t const hash) noexcept
+    {
+        return (hash ^ (hash >> 29)) * 0xBF58476D1CE4E5B9ULL;
+    }
+
+    size_t block(uint64_t const hash) const noexcept
+    {
+        return (block_bits == 0) ? 0 : (hash >> (64 - block_bits)) * block_words;
+    }
+
+    bool bloom_contains(uint64_t const hash, size_t const b) const noexcept
+    {
+        uint64_t bits = probe_bits(hash);
+        bool result{true};
+        for (size_t i = 0; i < probes; ++i, bits >>= 9)
+            result &= (bloom[b + ((bits & 511) >> 6)] >> (bits & 63)) & 1u;
+        return result;
+    }
+
+    bool array_contains(uint64_t const minHash) const noexcept
+    {
+        uint64_t const prefix = minHash >> value_shift;
+        if (prefix + 1 >= index.size())
+            return false;
+        auto first = values.begin() + index[prefix];
+        auto last = values.begin() + index[prefix + 1];
+        return std::binary_search(first, last, minHash);
+    }
+
+    // Create the Bloom filter and the index for the sorted values.
+    void build()
+    {
+        if (values.empty())
+            return;
+
+        size_t const blocks = std::bit_ceil(std::max<size_t>(1, values.size() * bits_per_minimiser / 512));
+        block_bits = std::countr_zero(blocks);
+        bloom.assign(blocks * block_words, 0);
+        for (uint64_t const minHash : values)
+        {
+            uint64_t const hash = mix(minHash);
+            size_t const b = block(hash);
+            uint64_t bits = probe_bits(hash);
+            for (size_t i = 0; i < probes; ++i, bits >>= 9)
+                bloom[b + ((bits & 511) >> 6)] |= uint64_t{1} << (bits & 63);
+        }
+
+        // About eight minimisers per index entry. A shift by 64 is undefined, so small sets index at least one bit.
+        int const index_bits = std::clamp<int>(std::bit_width(values.size()) - 3, 0, 26);
+        value_shift = std::clamp<int>(std::bit_width(values.back()) - index_bits, 0, 63);
+        index.assign((values.back() >> value_shift) + 2, 0);
+        size_t pos{0};
+        for (uint64_t p = 0; p + 1 < index.size(); ++p)
+        {
+            while ((pos < values.size()) && ((values[pos] >> value_shift) < p))
+                ++pos;
+            index[p] = pos;
+        }
+        index.back() = values.size();
+    }
+
+public:
+    //!\brief An empty set.
+    minimiser_set() = default;
+
+    //!\brief A set of the given minimisers, which may be unsorted and contain duplicates.
+    explicit minimiser_set(std::vector<uint64_t> minimisers) : owned_values{std::move(minimisers)}
+    {
+        std::sort(owned_values.begin(), owned_values.end());
+        owned_values.erase(std::unique(owned_values.begin(), owned_values.end()), owned_values.end());
+        owned_values.shrink_to_fit();
+        values = owned_values;
+        build();
+    }
+
+    /*!\brief A set of minimisers stored in a memory mapped file.
+     * \param file   The mapped file, which is kept open by the set.
+     * \param offset The position of the first minimiser in bytes, has to be a multiple of 8.
+     * \param count  The number of minimisers, which have to be sorted and unique.
+     */
+    minimiser_set(mapped_file file, size_t const offset, size_t const count) : mapping{std::move(file)}
+    {
+        values = {reinterpret_cast<uint64_t const *>(mapping.data() + offset), count};
+        build();
+    }
+
+    minimiser_set(minimiser_set const &) = delete;
+    minimiser_set & operator=(minimiser_set const &) = delete;
+    minimiser_set(minimiser_set &&) = default;
+    minimiser_set & operator=(minimiser_set &&) = default;
+
+    size_t size() const noexcept
+    {
+        return values.size();
+    }
+
+    bool empty() const noexcept
+    {
+        return values.empty();
+    }
+
+    bool contains(uint64_t const minHash) const noexcept
+    {
+        if (values.empty())
+            return false;
+        uint64_t const hash = mix(minHash);
+        return bloom_contains(hash, block(hash)) && array_contains(minHash);
+    }
+
+    /*!\brief Removes minimisers from a vector, the order of the remaining minimisers is kept.
+     * \param minimisers     The minimisers to filter.
+     * \param keep_contained If true, only contained minimisers are kept, otherwise only minimisers not contained.
+     */
+    void filter(std::vector<uint64_t> & minimisers, bool const keep_contained) const
+    {
+        if (values.empty())
+        {
+            if (keep_contained)
+                minimisers.clear();
+            return;
+        }
+
+        std::array<uint64_t, batch_size> hashes;
+        std::array<size_t, batch_size> blocks;
+        size_t kept{0};
+        for (size_t start = 0; start < minimisers.size(); start += batch_size)
+        {
+            size_t const end = std::min(start + batch_size, minimisers.size());
+            for (size_t i = start; i < end; ++i)
+            {
+                hashes[i - start] = mix(minimisers[i]);
+                blocks[i - start] = block(hashes[i - start]);
+                __builtin_prefetch(bloom.data() + blocks[i - start]);
+            }
+            for (size_t i = start; i < end; ++i)
+            {
+                uint64_t const minHash = minimisers[i];
+                bool const contained = bloom_contains(hashes[i - start], blocks[i - start]) && array_contains(minHash);
+                if (contained == keep_contained)
+                    minimisers[kept++] = minHash;
+            }
+        }
+        minimisers.resize(kept);
+    }
+
+    //!\brief The minimisers in increasing order.
+    auto begin() const noexcept
+    {
+        return values.begin();
+    }
+
+    auto end() const noexcept
+    {
+        return values.end();
+    }
+};
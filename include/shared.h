@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <sstream>
+
 #include <robin_hood.h>
 
 #include <seqan3/alphabet/nucleotide/dna4.hpp>
@@ -43,6 +45,12 @@ struct estimate_ibf_arguments : min_arguments
     std::vector<uint16_t> expression_thresholds{}; // Expression levels which should be created
     uint8_t number_expression_thresholds{}; // If set, the expression levels are determined by the program.
     bool samplewise{false};
+    // Number of IBFs per level, the experiments are grouped by their size. Not stored, an index is partitioned if it has
+    // an IBF_Partitions.partitions file.
+    uint8_t partitions{1};
+    // Bin size of the IBFs per level. If given, it replaces the bin size determined by the false positive rate, so
+    // indexes of different experiments, which are built independently, can be merged. Not stored.
+    std::vector<uint64_t> bin_sizes{};
 
     template<class Archive>
     void save(Archive & archive) const
@@ -93,6 +101,37 @@ static void store_args(estimate_ibf_arguments const & args, std::filesystem::pat
     oarchive(args);
 }
 
+/*! \brief Function, loading the experiments of every partition of an index
+ *  \param partitions The experiments of every partition in the order of their bins, empty if the index is not
+ *                    partitioned.
+ *  \param ipath      Path, where the partitions can be found.
+ */
+static void load_partitions(std::vector<std::vector<size_t>> & partitions, std::filesystem::path ipath)
+{
+    partitions.clear();
+    std::ifstream is{ipath};
+    std::string line{};
+    while (std::getline(is, line) && (line != "/"))
+    {
+        std::stringstream sstream{line};
+        size_t experiment{};
+        partitions.emplace_back();
+        while (sstream >> experiment)
+            partitions.back().push_back(experiment);
+    }
+}
+
+/*! \brief The suffix of the IBF files of a partition, partitions are only named in partitioned indexes.
+ *  \param partition            The partition.
+ *  \param number_of_partitions The number of partitions of the index.
+ */
+static std::string partition_suffix(size_t const partition, size_t const number_of_partitions)
+{
+    if (number_of_partitions <= 1)
+        return "";
+    return "_Partition_" + std::to_string(partition);
+}
+
 //!\brief Use dna4 instead of default dna5
 struct my_traits : seqan3::sequence_file_input_default_traits_dna
 {
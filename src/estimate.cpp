@@ -27,10 +27,13 @@
 #include <seqan3/io/sequence_file/all.hpp>
 
 #include "estimate.h"
+#include "minimiser_hash.h"
 
-// Actual estimation
+// Actual estimation, ibfs are the IBFs of the partitions of the current level and partitions the experiments of their
+// bins. Without partitions, there is only one IBF.
 template <class IBFType, bool last_exp, bool normalization, typename exp_t>
-void check_ibf(min_arguments const & args, IBFType const & ibf, std::vector<uint16_t> & estimations_i,
+void check_ibf(min_arguments const & args, std::vector<IBFType> const & ibfs,
+               std::vector<std::vector<size_t>> const & partitions, std::vector<uint16_t> & estimations_i,
                seqan3::dna4_vector const seq, std::vector<uint32_t> & prev_counts,
                exp_t const & expressions, uint16_t const k, std::vector<double> const fprs)
 {
@@ -39,13 +42,29 @@ void check_ibf(min_arguments const & args, IBFType const & ibf, std::vector<uint
 
     // Count minimisers in ibf of current level
     std::vector<uint32_t> counter;
-    counter.assign(ibf.bin_count(), 0);
+    counter.assign(estimations_i.size(), 0);
     uint64_t minimiser_length = 0;
-    for (auto minHash : seqan3::views::minimiser_hash(seq, args.shape, args.w_size, args.s))
+    std::vector<uint64_t> minimisers{};
+    compute_minimisers(args, seq, minimisers);
+    for (auto minHash : minimisers)
     {
-        auto agent = ibf.membership_agent();
-        std::transform (counter.begin(), counter.end(), agent.bulk_contains(minHash).begin(), counter.begin(),
-                        std::plus<int>());
+        if (partitions.empty())
+        {
+            auto agent = ibfs[0].membership_agent();
+            std::transform (counter.begin(), counter.end(), agent.bulk_contains(minHash).begin(), counter.begin(),
+                            std::plus<int>());
+        }
+        else
+        {
+            // The counts of the partitions are sorted back into the order of the experiments.
+            for (size_t p = 0; p < ibfs.size(); ++p)
+            {
+                auto agent = ibfs[p].membership_agent();
+                auto & result = agent.bulk_contains(minHash);
+                for (size_t b = 0; b < partitions[p].size(); ++b)
+                    counter[partitions[p][b]] += result[b];
+            }
+        }
         ++minimiser_length;
     }
 
@@ -132,13 +151,12 @@ void read_levels(std::vector<std::vector<float_or_int>> & expressions, std::file
 
 /*! \brief Function to estimate expression value.
 *  \param args        The arguments.
-*  \param ibf         The ibf determing what kind ibf is used (compressed or uncompressed).
 *  \param file_out    The output file.
 *  \param estimate_args  The estimate arguments.
+*  \tparam IBFType    The kind of ibf used (compressed or uncompressed).
 */
 template <class IBFType, bool samplewise, bool normalization_method = false>
-void estimate(estimate_ibf_arguments & args, IBFType & ibf, std::filesystem::path file_out,
-              estimate_arguments const & estimate_args)
+void estimate(estimate_ibf_arguments & args, std::filesystem::path file_out, estimate_arguments const & estimate_args)
 {
     std::vector<std::string> ids;
     std::vector<seqan3::dna4_vector> seqs;
@@ -149,6 +167,8 @@ void estimate(estimate_ibf_arguments & args, IBFType & ibf, std::filesystem::pat
     std::vector<std::vector<uint16_t>> estimations;
     std::vector<std::vector<uint16_t>> expressions;
     std::vector<std::vector<double>> fprs;
+    std::vector<std::vector<size_t>> partitions;
+    std::vector<IBFType> ibfs;
 
     omp_set_num_threads(args.threads);
     seqan3::contrib::bgzf_thread_count = args.threads;
@@ -170,13 +190,33 @@ void estimate(estimate_ibf_arguments & args, IBFType & ibf, std::filesystem::pat
     // Make sure expression levels are sorted.
     sort(args.expression_thresholds.begin(), args.expression_thresholds.end());
 
+    // A partitioned index has one IBF per partition and level, its experiments are stored in the partitions file.
+    load_partitions(partitions, estimate_args.path_in.string() + "IBF_Partitions.partitions");
+    ibfs.resize(std::max<size_t>(partitions.size(), 1));
+    auto load_level = [&] (size_t const j)
+    {
+        for (size_t p = 0; p < ibfs.size(); ++p)
+        {
+            if constexpr (samplewise)
+                load_ibf(ibfs[p], estimate_args.path_in.string() + "IBF_Level_" + std::to_string(j) +
+                                  partition_suffix(p, partitions.size()));
+            else
+                load_ibf(ibfs[p], estimate_args.path_in.string() + "IBF_" + std::to_string(args.expression_thresholds[j]) +
+                                  partition_suffix(p, partitions.size()));
+        }
+    };
+
     // Initialse last expression.
-    if constexpr (samplewise)
-        load_ibf(ibf, estimate_args.path_in.string() + "IBF_Level_" + std::to_string(args.number_expression_thresholds-1));
-    else
-        load_ibf(ibf, estimate_args.path_in.string() + "IBF_" + std::to_string(args.expression_thresholds[args.expression_thresholds.size()-1]));
-    counter.assign(ibf.bin_count(), 0);
-    counter_est.assign(ibf.bin_count(), 0);
+    load_level(args.number_expression_thresholds-1);
+    size_t number_of_bins{ibfs[0].bin_count()};
+    if (!partitions.empty())
+    {
+        number_of_bins = 0;
+        for (auto && partition : partitions)
+            number_of_bins += partition.size();
+    }
+    counter.assign(number_of_bins, 0);
+    counter_est.assign(number_of_bins, 0);
 
     for (int i = 0; i < seqs.size(); ++i)
     {
@@ -191,15 +231,15 @@ void estimate(estimate_ibf_arguments & args, IBFType & ibf, std::filesystem::pat
     for (int i = 0; i < seqs.size(); ++i)
     {
         if constexpr (samplewise & normalization_method)
-            check_ibf<IBFType, true, true>(args, ibf, estimations[i], seqs[i], prev_counts[i],
+            check_ibf<IBFType, true, true>(args, ibfs, partitions, estimations[i], seqs[i], prev_counts[i],
                                            expressions,args.number_expression_thresholds - 1,
                                            fprs[args.number_expression_thresholds - 1]);
         else if constexpr (samplewise)
-            check_ibf<IBFType, true, false>(args, ibf, estimations[i], seqs[i], prev_counts[i],
+            check_ibf<IBFType, true, false>(args, ibfs, partitions, estimations[i], seqs[i], prev_counts[i],
                                             expressions, args.number_expression_thresholds - 1,
                                             fprs[args.number_expression_thresholds - 1]);
         else
-            check_ibf<IBFType, true, false>(args, ibf, estimations[i], seqs[i], prev_counts[i],
+            check_ibf<IBFType, true, false>(args, ibfs, partitions, estimations[i], seqs[i], prev_counts[i],
                                             args.expression_thresholds[args.expression_thresholds.size() - 1], prev_expression,
                                             fprs[args.expression_thresholds.size() - 1]);
     }
@@ -210,23 +250,20 @@ void estimate(estimate_ibf_arguments & args, IBFType & ibf, std::filesystem::pat
     for (int j = args.number_expression_thresholds - 2; j >= 0; j--)
     {
         // Loadthe next ibf that should be considered.
-        if constexpr (samplewise)
-            load_ibf(ibf, estimate_args.path_in.string() + "IBF_Level_" + std::to_string(j));
-        else
-            load_ibf(ibf, estimate_args.path_in.string() + "IBF_" + std::to_string(args.expression_thresholds[j]));
+        load_level(j);
 
         // Go over the sequences
         #pragma omp parallel for
         for (int i = 0; i < seqs.size(); ++i)
         {
             if constexpr (samplewise & normalization_method)
-                check_ibf<IBFType, false, true>(args, ibf, estimations[i], seqs[i], prev_counts[i],
+                check_ibf<IBFType, false, true>(args, ibfs, partitions, estimations[i], seqs[i], prev_counts[i],
                                       expressions, j, fprs[j]);
             else if constexpr (samplewise)
-                check_ibf<IBFType, false, false>(args, ibf, estimations[i], seqs[i], prev_counts[i],
+                check_ibf<IBFType, false, false>(args, ibfs, partitions, estimations[i], seqs[i], prev_counts[i],
                                           expressions, j, fprs[j]);
             else
-                check_ibf<IBFType, false, false>(args, ibf, estimations[i], seqs[i], prev_counts[i],
+                check_ibf<IBFType, false, false>(args, ibfs, partitions, estimations[i], seqs[i], prev_counts[i],
                                           args.expression_thresholds[j], prev_expression, fprs[j]);
         }
 
@@ -240,7 +277,7 @@ void estimate(estimate_ibf_arguments & args, IBFType & ibf, std::filesystem::pat
     for (int i = 0; i <  seqs.size(); ++i)
     {
         outfile << ids[i] << "\t";
-        for (int j = 0; j < ibf.bin_count(); ++j)
+        for (int j = 0; j < number_of_bins; ++j)
              outfile << estimations[i][j] << "\t";
 
         outfile << "\n";
@@ -256,32 +293,30 @@ void call_estimate(estimate_ibf_arguments & args, estimate_arguments & estimate_
 
     if (args.compressed)
     {
-        seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed> ibf;
         if (args.samplewise)
         {
             if (estimate_args.normalization_method)
-                estimate<seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed>, true, true>(args, ibf, args.path_out, estimate_args);
+                estimate<seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed>, true, true>(args, args.path_out, estimate_args);
             else
-                estimate<seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed>, true>(args, ibf, args.path_out, estimate_args);
+                estimate<seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed>, true>(args, args.path_out, estimate_args);
         }
         else
         {
-            estimate<seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed>, false>(args, ibf, args.path_out, estimate_args);
+            estimate<seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed>, false>(args, args.path_out, estimate_args);
         }
     }
     else
     {
-        seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed> ibf;
         if (args.samplewise)
         {
             if (estimate_args.normalization_method)
-                estimate<seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed>, true, true>(args, ibf, args.path_out, estimate_args);
+                estimate<seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed>, true, true>(args, args.path_out, estimate_args);
             else
-                estimate<seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed>, true>(args, ibf, args.path_out, estimate_args);
+                estimate<seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed>, true>(args, args.path_out, estimate_args);
         }
         else
         {
-            estimate<seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed>, false>(args, ibf, args.path_out, estimate_args);
+            estimate<seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed>, false>(args, args.path_out, estimate_args);
         }
     }
 }
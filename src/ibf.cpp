@@ -6,13 +6,21 @@
 // -----------------------------------------------------------------------------------------------------
 
 #include <chrono>
+#include <cstring>
 #include <deque>
 #include <iostream>
 #include <math.h>
+#include <mutex>
+#include <shared_mutex>
 #include <numeric>
 #include <omp.h>
+#include <queue>
+#include <sstream>
 #include <string>
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <fstream>
 
 #include <filesystem>
 #include <ranges>
@@ -30,22 +38,155 @@
 #include <seqan3/io/stream/detail/fast_istreambuf_iterator.hpp>
 #include <seqan3/utility/container/dynamic_bitset.hpp>
 
+#include "count_min_sketch.h"
+#include "hyperloglog.h"
 #include "ibf.h"
+#include "mapped_file.h"
+#include "minimiser_file.h"
+#include "minimiser_hash.h"
+#include "minimiser_set.h"
 #include "shared.h"
 
+// Header of the cache for the minimisers of an include or exclude file, followed by the sorted minimisers.
+struct minimiser_set_cache_header
+{
+    char magic[8]{'N', 'E', 'E', 'D', 'L', 'E', 'M', 'S'};
+    uint64_t version{1};
+    uint64_t seed{};
+    uint64_t shape{};
+    uint64_t source_size{}; // Size and modification time of the sequence file, a changed file invalidates the cache.
+    int64_t source_time{};
+    uint32_t window{};
+    uint32_t k{};
+    uint64_t number_of_minimisers{};
+};
+static_assert(sizeof(minimiser_set_cache_header) == 64);
+
+// The cache is stored next to the sequence file, so all runs using the file share it. If that directory is not writable,
+// it is stored with the output instead. Its name contains the name of the sequence file and the minimiser arguments.
+std::array<std::filesystem::path, 2> minimiser_set_cache_paths(min_arguments const & args,
+                                                               std::filesystem::path const & file)
+{
+    std::string const suffix = ".k" + std::to_string(args.k) + "_w" + std::to_string(args.w_size.get()) + "_s" +
+                               std::to_string(args.s.get()) + "_" + std::to_string(args.shape.to_ulong()) + ".minimisers";
+    return {file.string() + suffix, args.path_out.string() + file.filename().string() + suffix};
+}
+
+minimiser_set_cache_header get_minimiser_set_cache_header(min_arguments const & args, std::filesystem::path const & file)
+{
+    minimiser_set_cache_header header{};
+    header.seed = args.s.get();
+    header.shape = args.shape.to_ulong();
+    header.source_size = std::filesystem::file_size(file);
+    header.source_time = std::filesystem::last_write_time(file).time_since_epoch().count();
+    header.window = args.w_size.get();
+    header.k = args.k;
+    return header;
+}
+
+// Read the minimisers of file from the cache at cache_path, returns false if there is no valid cache.
+bool read_minimiser_set_cache(min_arguments const & args, std::filesystem::path const & file,
+                              std::filesystem::path const & cache_path, minimiser_set & table)
+{
+    mapped_file cache{cache_path};
+    if (!cache.is_open() || (cache.size() < sizeof(minimiser_set_cache_header)))
+        return false;
+
+    minimiser_set_cache_header header{};
+    std::memcpy(&header, cache.data(), sizeof(header));
+    minimiser_set_cache_header expected = get_minimiser_set_cache_header(args, file);
+    expected.number_of_minimisers = header.number_of_minimisers;
+    if ((std::memcmp(&header, &expected, sizeof(header)) != 0) ||
+        (cache.size() != sizeof(header) + header.number_of_minimisers * sizeof(uint64_t)))
+        return false;
+
+    // The minimisers are used directly from the mapped cache.
+    table = minimiser_set{std::move(cache), sizeof(header), header.number_of_minimisers};
+    return true;
+}
+
+// Store the minimisers of file in the cache at cache_path, returns false if it could not be written.
+bool write_minimiser_set_cache(minimiser_set_cache_header const & header, std::vector<uint64_t> const & minimisers,
+                               std::filesystem::path const & cache_path)
+{
+    // Write to a temporary file first, so that concurrent runs never read an incomplete cache.
+    std::filesystem::path const tmp_path = cache_path.string() + "." + std::to_string(getpid()) + ".tmp";
+    std::ofstream outfile{tmp_path, std::ios::binary};
+    outfile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    outfile.write(reinterpret_cast<const char*>(minimisers.data()), minimisers.size() * sizeof(uint64_t));
+    outfile.close();
+
+    std::error_code ec;
+    if (outfile)
+        std::filesystem::rename(tmp_path, cache_path, ec);
+    if (!outfile || ec)
+    {
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+// Read the minimisers of file from the first valid of its caches, returns false if there is none.
+bool read_minimiser_set_cache(min_arguments const & args, std::filesystem::path const & file, minimiser_set & table)
+{
+    for (auto && cache_path : minimiser_set_cache_paths(args, file))
+    {
+        if (read_minimiser_set_cache(args, file, cache_path, table))
+            return true;
+    }
+    return false;
+}
+
+// Store the minimisers of file in its cache next to it or, if that fails, with the output. If neither directory is
+// writable, no cache is created.
+void write_minimiser_set_cache(min_arguments const & args, std::filesystem::path const & file,
+                               minimiser_set const & table)
+{
+    std::vector<uint64_t> minimisers(table.begin(), table.end());
+    minimiser_set_cache_header header = get_minimiser_set_cache_header(args, file);
+    header.number_of_minimisers = minimisers.size();
+
+    for (auto && cache_path : minimiser_set_cache_paths(args, file))
+    {
+        if (write_minimiser_set_cache(header, minimisers, cache_path))
+            return;
+    }
+}
+
 // Create set with hashes from the minimisers from an include or exclude file.
 void get_include_set_table(min_arguments const & args, std::filesystem::path const include_file,
-                           robin_hood::unordered_set<uint64_t> & include_table)
+                           minimiser_set & include_table)
 {
+    if (read_minimiser_set_cache(args, include_file, include_table))
+        return;
+
     seqan3::sequence_file_input<my_traits,  seqan3::fields<seqan3::field::seq>> fin3{include_file};
+    std::vector<uint64_t> minimisers{};
+    std::vector<uint64_t> all_minimisers{};
     for (auto & [seq] : fin3)
     {
         if (seq.size() >= args.w_size.get())
         {
-            for (auto && minHash : seqan3::views::minimiser_hash(seq, args.shape, args.w_size, args.s))
-                include_table.insert(minHash);
+            compute_minimisers(args, seq, minimisers);
+            all_minimisers.insert(all_minimisers.end(), minimisers.begin(), minimisers.end());
         }
     }
+    include_table = minimiser_set{std::move(all_minimisers)};
+
+    write_minimiser_set_cache(args, include_file, include_table);
+}
+
+// Remove the minimisers, which are not in the include set or are in the exclude set.
+inline void filter_minimisers(std::vector<uint64_t> & minimisers,
+                              minimiser_set const & include_set_table,
+                              minimiser_set const & exclude_set_table,
+                              bool const only_include)
+{
+    if (only_include)
+        include_set_table.filter(minimisers, true);
+    else if (!exclude_set_table.empty())
+        exclude_set_table.filter(minimisers, false);
 }
 
 // Chech if file has fasta format to estimate cutoffs.
@@ -101,55 +242,488 @@ uint8_t calculate_cutoff(std::filesystem::path sequence_file, int samples)
     return cutoff;
 }
 
+// Number of records one thread hashes at once, if the reads of one sample are distributed over several threads.
+static constexpr size_t records_per_chunk{4096};
+
+// Upper bits of a hash of minHash, used to partition minimisers. The flat_counter_table and the count_min_sketch use
+// the upper bits of products with other multipliers, so all minimisers of one part are still spread over a whole table.
+inline size_t hash_prefix(uint64_t const minHash, int const bits) noexcept
+{
+    return (bits == 0) ? 0 : (minHash * 0xFF51AFD7ED558CCDULL) >> (64 - bits);
+}
+
+// Add one occurrence of minHash to the hash table. The cutoff table is either an exact flat_counter_table or a
+// count_min_sketch. Minimisers are moved to the hash table, when they pass the cutoff. With the sketch, a minimiser
+// passes it by its estimate, so a minimiser might be counted although it does not occur more often than the cutoff.
+template <typename cutoff_table_t>
+inline void count_minimiser(uint64_t const minHash,
+                            flat_counter_table<uint16_t> & hash_table,
+                            cutoff_table_t & cutoff_table,
+                            uint8_t const cutoff)
+{
+    auto it = hash_table.find(minHash);
+    // If minHash is already in hash table, increase count in hash table
+    if (it != hash_table.end())
+    {
+        it->second = std::min<uint16_t>(65534u, it->second + 1);
+        return;
+    }
+
+    if constexpr (std::same_as<cutoff_table_t, count_min_sketch>)
+    {
+        // If the estimate passes the cutoff, minHash is counted in the hash table from now on. Its counters might be
+        // shared with other minimisers, so counting starts at the estimate, which is never smaller than the true count.
+        if (uint16_t const estimate = cutoff_table.increment_above(minHash, cutoff); estimate > 0)
+            hash_table[minHash] = estimate;
+    }
+    else
+    {
+        auto & cutoff_count = cutoff_table[minHash];
+        // If minHash equals now the cutoff than add it to the hash table and add plus one for the current
+        // iteration.
+        if (cutoff_count == cutoff)
+        {
+            hash_table[minHash] = cutoff_count + 1;
+            cutoff_table.erase(minHash);
+        }
+        // If none of the above, increase count in cutoff table. Cutoff Table increases RAM usage by storing
+        // minimisers with a low occurence in a smaller hash table.
+        else
+        {
+            cutoff_count++;
+        }
+    }
+}
+
 // Fill hash table with minimisers greater than the cutoff.
+template <typename cutoff_table_t>
 void fill_hash_table(min_arguments const & args,
                      seqan3::sequence_file_input<my_traits,  seqan3::fields<seqan3::field::seq>> & fin,
-                     robin_hood::unordered_node_map<uint64_t, uint16_t> & hash_table,
-                     robin_hood::unordered_node_map<uint64_t, uint8_t> & cutoff_table,
-                     robin_hood::unordered_set<uint64_t> const & include_set_table,
-                     robin_hood::unordered_set<uint64_t> const & exclude_set_table,
+                     flat_counter_table<uint16_t> & hash_table,
+                     cutoff_table_t & cutoff_table,
+                     minimiser_set const & include_set_table,
+                     minimiser_set const & exclude_set_table,
                      bool const only_include = false, uint8_t cutoff = 0)
 {
+    std::vector<uint64_t> minimisers{};
     for (auto & [seq] : fin)
     {
-        for (auto && minHash : seqan3::views::minimiser_hash(seq, args.shape, args.w_size, args.s))
+        compute_minimisers(args, seq, minimisers);
+        filter_minimisers(minimisers, include_set_table, exclude_set_table, only_include);
+        for (auto && minHash : minimisers)
+            count_minimiser(minHash, hash_table, cutoff_table, cutoff);
+    }
+}
+
+// Call process(p) for every non-empty batch p while holding its lock, the batch is cleared afterwards. Batches whose lock
+// is held by another thread are skipped in a first round starting at batch first, and waited for in a second round.
+template <typename lock_of_t, typename process_t>
+void for_each_locked(size_t const number_of_batches, size_t const first, std::vector<std::vector<uint64_t>> & batches,
+                     lock_of_t && lock_of, process_t && process)
+{
+    for (size_t i = 0; i < number_of_batches; ++i)
+    {
+        size_t const p = (first + i) % number_of_batches;
+        std::mutex & lock = lock_of(p);
+        if (batches[p].empty() || !lock.try_lock())
+            continue;
+        process(p);
+        lock.unlock();
+        batches[p].clear();
+    }
+    for (size_t i = 0; i < number_of_batches; ++i)
+    {
+        size_t const p = (first + i) % number_of_batches;
+        if (batches[p].empty())
+            continue;
+        std::lock_guard<std::mutex> lock{lock_of(p)};
+        process(p);
+        batches[p].clear();
+    }
+}
+
+// The counts of all minimisers with the same hash_prefix, only the thread holding the lock modifies them.
+template <typename cutoff_table_t>
+struct counting_shard
+{
+    std::mutex lock{};
+    flat_counter_table<uint16_t> hash_table{};
+    cutoff_table_t cutoff_table{};
+};
+
+// Fill the shards with minimisers by distributing the reads of number_of_files sequence files over several threads.
+// Every file is read by its own task, so the mates of paired experiments are decompressed and parsed at the same time.
+// A reading task fills chunks of records, which are hashed by all threads. The minimisers of a chunk are sorted into
+// one batch per shard, which is counted as soon as no other thread counts the same shard. As every minimiser is counted
+// in exactly one shard, the shards give the same counts as counting with one thread and do not have to be merged.
+template <typename cutoff_table_t>
+void fill_hash_table_parallel(min_arguments const & args,
+                              std::vector<std::filesystem::path> const & sequence_files,
+                              unsigned const file_iterator, unsigned const number_of_files,
+                              std::vector<counting_shard<cutoff_table_t>> & shards,
+                              minimiser_set const & include_set_table,
+                              minimiser_set const & exclude_set_table,
+                              bool const only_include, uint8_t const cutoff, uint8_t const threads)
+{
+    int const shard_bits = std::countr_zero(shards.size());
+    // Batches per thread and shard, they are kept, so their memory is reused for the next chunks.
+    std::vector<std::vector<std::vector<uint64_t>>> batches(threads, std::vector<std::vector<uint64_t>>(shards.size()));
+    // Two chunks per thread and file, so a reading task can fill new chunks while the others are hashed.
+    std::vector<std::vector<std::vector<seqan3::dna4_vector>>> chunks(number_of_files,
+                                                                      std::vector<std::vector<seqan3::dna4_vector>>(2 * threads));
+    // The files are opened here, so errors are reported to the caller and not raised inside a task.
+    std::vector<seqan3::sequence_file_input<my_traits, seqan3::fields<seqan3::field::seq>>> files{};
+    files.reserve(number_of_files);
+    for (unsigned f = 0; f < number_of_files; f++)
+        files.emplace_back(sequence_files[file_iterator+f]);
+
+    #pragma omp parallel num_threads(threads)
+    #pragma omp single
+    {
+        for (unsigned f = 0; f < number_of_files; f++)
         {
-            if ((only_include & (include_set_table.contains(minHash))) | (!only_include) & !(exclude_set_table.contains(minHash)))
+            #pragma omp task firstprivate(f)
             {
-                auto it = hash_table.find(minHash);
-                // If minHash is already in hash table, increase count in hash table
-                if (it != hash_table.end())
-                {
-                    it->second = std::min<uint16_t>(65534u, hash_table[minHash] + 1);
-                }
-                // If minHash equals now the cutoff than add it to the hash table and add plus one for the current
-                // iteration.
-                else if (cutoff_table[minHash] == cutoff)
+                auto & fin = files[f];
+                auto it = fin.begin();
+                for (size_t current = 0; it != fin.end(); current = (current + 1) % chunks[f].size())
                 {
-                    hash_table[minHash] = cutoff_table[minHash] + 1;
-                    cutoff_table.erase(minHash);
-                }
-                // If none of the above, increase count in cutoff table. Cutoff Table increases RAM usage by storing
-                // minimisers with a low occurence in a smaller hash table.
-                else
-                {
-                    cutoff_table[minHash]++;
+                    // All chunks of this file are in use, wait until they are hashed before reusing them.
+                    if (current == 0)
+                    {
+                        #pragma omp taskwait
+                    }
+
+                    for (; (it != fin.end()) && (chunks[f][current].size() < records_per_chunk); ++it)
+                    {
+                        auto & [seq] = *it;
+                        chunks[f][current].push_back(std::move(seq));
+                    }
+
+                    #pragma omp task firstprivate(f, current)
+                    {
+                        int const t = omp_get_thread_num();
+                        auto & batch = batches[t];
+                        std::vector<uint64_t> minimisers{};
+                        for (auto & seq : chunks[f][current])
+                        {
+                            compute_minimisers(args, seq, minimisers);
+                            filter_minimisers(minimisers, include_set_table, exclude_set_table, only_include);
+                            for (auto && minHash : minimisers)
+                                batch[hash_prefix(minHash, shard_bits)].push_back(minHash);
+                        }
+                        chunks[f][current].clear();
+
+                        // Shards locked by other threads are skipped first and waited for afterwards, threads start at
+                        // different shards.
+                        for_each_locked(shards.size(), t, batch, [&] (size_t const s) -> std::mutex & { return shards[s].lock; },
+                                        [&] (size_t const s)
+                        {
+                            for (auto && minHash : batch[s])
+                                count_minimiser(minHash, shards[s].hash_table, shards[s].cutoff_table, cutoff);
+                        });
+                    }
                 }
             }
         }
     }
 }
 
+// Fill hash table with the minimisers of number_of_files sequence files starting at file_iterator. The cutoff tables
+// are created by make_cutoff_table(parts), which gives a table for 1/parts of all minimisers.
+template <typename make_cutoff_table_t>
+void fill_hash_table_files(min_arguments const & args,
+                           std::vector<std::filesystem::path> const & sequence_files,
+                           unsigned const file_iterator, unsigned const number_of_files,
+                           flat_counter_table<uint16_t> & hash_table,
+                           make_cutoff_table_t && make_cutoff_table,
+                           minimiser_set const & include_set_table,
+                           minimiser_set const & exclude_set_table,
+                           bool const only_include, uint8_t const cutoff, uint8_t const threads)
+{
+    using cutoff_table_t = std::invoke_result_t<make_cutoff_table_t, size_t>;
+
+    if (threads == 1)
+    {
+        cutoff_table_t cutoff_table = make_cutoff_table(1);
+        for (unsigned f = 0; f < number_of_files; f++)
+        {
+            seqan3::sequence_file_input<my_traits, seqan3::fields<seqan3::field::seq>> fin{sequence_files[file_iterator+f]};
+            fill_hash_table(args, fin, hash_table, cutoff_table, include_set_table, exclude_set_table, only_include,
+                            cutoff);
+        }
+        return;
+    }
+
+    // More shards than threads, so a thread rarely finds all shards of its batches locked.
+    std::vector<counting_shard<cutoff_table_t>> shards(std::bit_ceil(4u * threads));
+    for (auto & shard : shards)
+        shard.cutoff_table = make_cutoff_table(shards.size());
+
+    fill_hash_table_parallel(args, sequence_files, file_iterator, number_of_files, shards, include_set_table,
+                             exclude_set_table, only_include, cutoff, threads);
+
+    // The shards contain disjoint minimisers, so their entries are only moved.
+    size_t number_of_minimisers{hash_table.size()};
+    for (auto & shard : shards)
+        number_of_minimisers += shard.hash_table.size();
+    hash_table.reserve(number_of_minimisers);
+    for (auto & shard : shards)
+    {
+        for (auto && elem : shard.hash_table)
+            hash_table[elem.first] = elem.second;
+        shard.hash_table = {};
+        shard.cutoff_table = {};
+    }
+}
+
+// Fill hash table with the minimisers of all sequence files belonging to one sample.
+void fill_hash_table_sample(min_arguments const & args,
+                            minimiser_arguments const & minimiser_args,
+                            std::vector<std::filesystem::path> const & sequence_files,
+                            unsigned const file_iterator, unsigned const number_of_files,
+                            flat_counter_table<uint16_t> & hash_table,
+                            minimiser_set const & include_set_table,
+                            minimiser_set const & exclude_set_table,
+                            uint8_t const cutoff, uint8_t const threads)
+{
+    bool const only_include = (minimiser_args.include_file != "");
+
+    if (minimiser_args.sketch_memory > 0)
+    {
+        // Fixed size sketch instead of the exact cutoff table, its size does not depend on the number of minimisers.
+        size_t const sketch_bytes = minimiser_args.sketch_memory * 1024 * 1024;
+        fill_hash_table_files(args, sequence_files, file_iterator, number_of_files, hash_table,
+                              [sketch_bytes] (size_t const parts) { return count_min_sketch{sketch_bytes / parts}; },
+                              include_set_table, exclude_set_table, only_include, cutoff, threads);
+    }
+    else
+    {
+        // Create a smaller cutoff table to save RAM, this cutoff table is only used for constructing the hash table
+        // and afterwards discarded.
+        fill_hash_table_files(args, sequence_files, file_iterator, number_of_files, hash_table,
+                              [] (size_t const) { return flat_counter_table<uint8_t>{}; },
+                              include_set_table, exclude_set_table, only_include, cutoff, threads);
+    }
+}
+
+// Minimiser hashes of one sample, partitioned by their value into temporary files. A bucket contains all occurrences of
+// its minimisers, so the buckets can be counted one after another with a fraction of the memory. Bucket b contains
+// smaller minimisers than bucket b + 1, so counting the buckets in order gives the minimisers in increasing order.
+// As minimisers are the smallest values of their windows, their values are far from uniform. The bucket boundaries are
+// therefore taken from the first minimisers pushed, so every bucket gets a similar number of minimisers.
+class minimiser_buckets
+{
+private:
+    std::vector<std::filesystem::path> paths{};
+    std::vector<std::vector<uint64_t>> buffers{};
+    size_t buffer_size{0};
+    std::vector<uint64_t> sample{};
+    size_t sample_size{0};
+    std::vector<uint64_t> splitters{}; // Bucket b contains the minimisers in [splitters[b - 1], splitters[b])
+
+    void flush(size_t const b)
+    {
+        // Files are only opened to append a full buffer, so the number of buckets is not limited by open files.
+        std::ofstream outfile{paths[b], std::ios::binary | std::ios::app};
+        outfile.write(reinterpret_cast<const char*>(buffers[b].data()), buffers[b].size() * sizeof(uint64_t));
+        if (!outfile)
+            throw std::runtime_error{"Could not write temporary file " + paths[b].string() + "."};
+        buffers[b].clear();
+    }
+
+    void add(uint64_t const minHash)
+    {
+        size_t const b = std::upper_bound(splitters.begin(), splitters.end(), minHash) - splitters.begin();
+        buffers[b].push_back(minHash);
+        if (buffers[b].size() == buffer_size)
+            flush(b);
+    }
+
+    // Choose the bucket boundaries as quantiles of the sample and distribute the sample.
+    void split()
+    {
+        std::vector<uint64_t> sorted_sample = sample;
+        std::sort(sorted_sample.begin(), sorted_sample.end());
+        for (size_t b = 1; b < buffers.size() && !sorted_sample.empty(); ++b)
+        {
+            uint64_t const splitter = sorted_sample[b * sorted_sample.size() / buffers.size()];
+            if (splitters.empty() || (splitter > splitters.back()))
+                splitters.push_back(splitter);
+        }
+        // Buckets without a splitter stay empty.
+        for (uint64_t const minHash : sample)
+            add(minHash);
+        sample = {};
+        sample_size = 0;
+    }
+
+public:
+    minimiser_buckets(std::filesystem::path const & prefix, size_t const number_of_buckets, size_t const buffer_records)
+    {
+        buffer_size = buffer_records;
+        buffers.resize(number_of_buckets);
+        for (size_t b = 0; b < buffers.size(); ++b)
+        {
+            paths.push_back(prefix.string() + ".bucket_" + std::to_string(b));
+            std::filesystem::remove(paths[b]);
+        }
+        sample_size = (number_of_buckets == 1) ? 0 : std::min<size_t>(64 * number_of_buckets, 1u << 18);
+        sample.reserve(sample_size);
+    }
+
+    minimiser_buckets(minimiser_buckets const &) = delete;
+    minimiser_buckets & operator=(minimiser_buckets const &) = delete;
+
+    ~minimiser_buckets()
+    {
+        for (auto & path : paths)
+        {
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+    }
+
+    size_t size() const noexcept
+    {
+        return buffers.size();
+    }
+
+    void push(uint64_t const minHash)
+    {
+        if (sample.size() < sample_size)
+        {
+            sample.push_back(minHash);
+            if (sample.size() == sample_size)
+                split();
+            return;
+        }
+        add(minHash);
+    }
+
+    // Write all buffered minimisers, the buffers are released afterwards, because they are not needed for counting.
+    void finish()
+    {
+        if (!sample.empty())
+            split();
+        for (size_t b = 0; b < buffers.size(); ++b)
+        {
+            if (!buffers[b].empty())
+                flush(b);
+            buffers[b] = {};
+        }
+    }
+
+    // Count all minimisers of bucket b, the bucket file is removed afterwards.
+    void count(size_t const b, flat_counter_table<uint16_t> & hash_table, std::vector<uint64_t> & buffer)
+    {
+        std::ifstream fin{paths[b], std::ios::binary};
+        while (fin)
+        {
+            fin.read(reinterpret_cast<char*>(buffer.data()), buffer.size() * sizeof(uint64_t));
+            size_t const records = fin.gcount() / sizeof(uint64_t);
+            for (size_t r = 0; r < records; ++r)
+            {
+                auto & minimiser_count = hash_table[buffer[r]];
+                minimiser_count = std::min<uint16_t>(65534u, minimiser_count + 1);
+            }
+        }
+        fin.close();
+        std::filesystem::remove(paths[b]);
+    }
+};
+
+// Number of minimiser occurrences in the given sequence files, estimated from the file sizes. This is an upper bound for
+// the number of distinct minimisers.
+uint64_t estimate_minimiser_occurrences(min_arguments const & args,
+                                        std::vector<std::filesystem::path> const & sequence_files,
+                                        unsigned const file_iterator, unsigned const number_of_files)
+{
+    uint64_t bases{0};
+    for (unsigned f = 0; f < number_of_files; f++)
+    {
+        std::filesystem::path const & file = sequence_files[file_iterator+f];
+        bool const is_compressed = file.extension() == ".gz" || file.extension() == ".bgzf" || file.extension() == ".bz2";
+        bool const is_fasta = is_compressed ? check_for_fasta_format(seqan3::format_fasta::file_extensions, file.stem())
+                                            : check_for_fasta_format(seqan3::format_fasta::file_extensions, file.extension());
+        bases += std::filesystem::file_size(file) * (is_compressed ? 3 : 1) / (is_fasta ? 1 : 2);
+    }
+    // On average two minimisers are found per w - k + 2 positions.
+    return 2 * bases / (args.w_size.get() - args.k + 2) + 1;
+}
+
+/*! \brief Counts the minimisers of one sample with a bounded amount of memory.
+ *  \details The minimisers are partitioned by their value into temporary files next to the output, which are counted
+ *           one after another. The number of buckets is chosen, such that the counts of one bucket fit into memory.
+ *           For every minimiser occurring more often than the cutoff, callback(minimiser, count) is called in
+ *           increasing order of the minimisers.
+ *  \param memory The memory in bytes, that can be used for this sample.
+ */
+template <typename callback_t>
+void count_sample_external(min_arguments const & args,
+                           minimiser_arguments const & minimiser_args,
+                           std::vector<std::filesystem::path> const & sequence_files,
+                           unsigned const file_iterator, unsigned const number_of_files,
+                           minimiser_set const & include_set_table,
+                           minimiser_set const & exclude_set_table,
+                           uint8_t const cutoff, size_t const memory, callback_t && callback)
+{
+    bool const only_include = (minimiser_args.include_file != "");
+    // A counted minimiser takes sizeof(uint64_t) + sizeof(uint16_t) bytes per slot, the table has a load factor between
+    // 3/8 and 3/4, and 16 bytes for sorting the minimisers passing the cutoff. Half of the memory is reserved for the
+    // write buffers and the table growing.
+    static constexpr size_t bytes_per_minimiser{43};
+    uint64_t const occurrences = estimate_minimiser_occurrences(args, sequence_files, file_iterator, number_of_files);
+    size_t const number_of_buckets = std::clamp<uint64_t>(2 * occurrences * bytes_per_minimiser / std::max<size_t>(memory, 1),
+                                                          1u, 4096u);
+    size_t const buffer_records = std::clamp<size_t>(memory / (4 * std::bit_ceil(number_of_buckets) * sizeof(uint64_t)),
+                                                     512u, 65536u);
+
+    minimiser_buckets buckets{args.path_out.string() + std::string{sequence_files[file_iterator].stem()},
+                              number_of_buckets, buffer_records};
+
+    std::vector<uint64_t> minimisers{};
+    for (unsigned f = 0; f < number_of_files; f++)
+    {
+        seqan3::sequence_file_input<my_traits, seqan3::fields<seqan3::field::seq>> fin{sequence_files[file_iterator+f]};
+        for (auto & [seq] : fin)
+        {
+            compute_minimisers(args, seq, minimisers);
+            filter_minimisers(minimisers, include_set_table, exclude_set_table, only_include);
+            for (auto && minHash : minimisers)
+                buckets.push(minHash);
+        }
+    }
+    buckets.finish();
+
+    flat_counter_table<uint16_t> hash_table{};
+    std::vector<uint64_t> buffer(buffer_records);
+    std::vector<std::pair<uint64_t, uint16_t>> counted{};
+    for (size_t b = 0; b < buckets.size(); ++b)
+    {
+        buckets.count(b, hash_table, buffer);
+        for (auto && elem : hash_table)
+        {
+            if (elem.second > cutoff)
+                counted.emplace_back(elem.first, elem.second);
+        }
+        hash_table.clear();
+
+        std::sort(counted.begin(), counted.end());
+        for (auto && [minHash, minimiser_count] : counted)
+            callback(minHash, minimiser_count);
+        counted.clear();
+    }
+}
+
 void count(min_arguments const & args, std::vector<std::filesystem::path> sequence_files, std::filesystem::path include_file,
            std::filesystem::path exclude_file, bool paired)
 {
-    robin_hood::unordered_node_map<uint64_t, uint16_t> hash_table{};
-    // Create a smaller cutoff table to save RAM, this cutoff table is only used for constructing the hash table
-    // and afterwards discarded.
-    robin_hood::unordered_node_map<uint64_t, uint8_t>  cutoff_table;
-    robin_hood::unordered_set<uint64_t> include_set_table{};
-    robin_hood::unordered_set<uint64_t> exclude_set_table{};
+    flat_counter_table<uint16_t> hash_table{};
+    minimiser_set include_set_table{};
+    minimiser_set exclude_set_table{};
     std::vector<uint64_t> counter{};
+    std::vector<uint64_t> minimisers{};
     uint64_t exp{};
     std::ofstream outfile;
     int j;
@@ -160,21 +734,11 @@ void count(min_arguments const & args, std::vector<std::filesystem::path> sequen
 
     for (unsigned i = 0; i < sequence_files.size(); i++)
     {
-
+        fill_hash_table_files(args, sequence_files, i, paired ? 2 : 1, hash_table,
+                              [] (size_t const) { return flat_counter_table<uint8_t>{}; },
+                              include_set_table, exclude_set_table, true, 0, args.threads);
         if (paired)
-        {
-            seqan3::sequence_file_input<my_traits, seqan3::fields<seqan3::field::seq>> fin{sequence_files[i]};
-            fill_hash_table(args, fin, hash_table, cutoff_table, include_set_table, exclude_set_table, true);
             i++;
-            fin = sequence_files[i];
-            fill_hash_table(args, fin, hash_table, cutoff_table, include_set_table, exclude_set_table, true);
-        }
-        else
-        {
-            seqan3::sequence_file_input<my_traits, seqan3::fields<seqan3::field::seq>> fin{sequence_files[i]};
-            fill_hash_table(args, fin, hash_table, cutoff_table, include_set_table, exclude_set_table, true);
-        }
-        cutoff_table.clear();
 
         outfile.open(std::string{args.path_out} + std::string{sequence_files[i].stem()} + ".count.out");
         j = 0;
@@ -183,8 +747,12 @@ void count(min_arguments const & args, std::vector<std::filesystem::path> sequen
         {
             if (seq.size() >= args.w_size.get())
             {
-                for (auto && minHash : seqan3::views::minimiser_hash(seq, args.shape, args.w_size, args.s))
-                    counter.push_back(hash_table[minHash]);
+                compute_minimisers(args, seq, minimisers);
+                for (auto && minHash : minimisers)
+                {
+                    auto it = hash_table.find(minHash);
+                    counter.push_back((it != hash_table.end()) ? it->second : 0u);
+                }
                 std::nth_element(counter.begin(), counter.begin() + counter.size()/2, counter.end());
                 exp =  counter[counter.size()/2];
                 counter.clear();
@@ -197,72 +765,32 @@ void count(min_arguments const & args, std::vector<std::filesystem::path> sequen
     }
 }
 
-void read_binary(std::filesystem::path filename, robin_hood::unordered_node_map<uint64_t, uint16_t> & hash_table)
+void read_binary(std::filesystem::path filename, flat_counter_table<uint16_t> & hash_table)
 {
-    std::ifstream fin;
-
-    uint8_t small_buffer;
-    uint32_t window;
-    uint64_t buffer;
-    fin.open(filename, std::ios::binary);
-    fin.read((char*)&buffer, sizeof(buffer));
-    fin.read((char*)&small_buffer, sizeof(small_buffer));
-    fin.read((char*)&small_buffer, sizeof(small_buffer));
-    fin.read((char*)&window, sizeof(window));
-    fin.read((char*)&buffer, sizeof(buffer));
-    bool ungapped;
-    fin.read((char*)&ungapped, sizeof(ungapped));
-    if (!ungapped)
+    minimiser_file_reader fin{filename};
+    hash_table.reserve(hash_table.size() + fin.header().number_of_minimisers);
+    fin.for_each([&] (uint64_t const minimiser, uint16_t const minimiser_count)
     {
-        fin.read((char*)&buffer, sizeof(buffer));
-    }
-
-    uint64_t minimiser;
-    uint16_t minimiser_count;
-
-    while(fin.read((char*)&minimiser, sizeof(minimiser)))
-    {
-        fin.read((char*)&minimiser_count, sizeof(minimiser_count));
         hash_table[minimiser] = minimiser_count;
-    }
-
-    fin.close();
+    });
 }
 
 void read_binary_start(min_arguments & args,
                  std::filesystem::path filename,
                  uint64_t & num_of_minimisers, uint8_t & cutoff)
 {
-    std::ifstream fin;
-
-    uint32_t window;
-    uint64_t buffer;
-    uint8_t small_buffer;
-    fin.open(filename, std::ios::binary);
-    fin.read((char*)&buffer, sizeof(buffer));
-    num_of_minimisers = buffer;
-
-    fin.read((char*)&small_buffer, sizeof(small_buffer));
-    cutoff = small_buffer;
-    fin.read((char*)&args.k, sizeof(args.k));
-    fin.read((char*)&window, sizeof(window));
-    args.w_size = seqan3::window_size{window};
-    fin.read((char*)&buffer, sizeof(buffer));
-    args.s = seqan3::seed{buffer};
-
-    bool ungapped;
-    fin.read((char*)&ungapped, sizeof(ungapped));
-    if (ungapped)
-    {
+    minimiser_file_reader fin{filename};
+    minimiser_file_header const & header = fin.header();
+    num_of_minimisers = header.number_of_minimisers;
+    cutoff = header.cutoff;
+    args.k = header.k;
+    args.w_size = seqan3::window_size{header.window};
+    args.s = seqan3::seed{header.seed};
+
+    if (header.ungapped)
         args.shape = seqan3::ungapped{args.k};
-    }
     else
-    {
-        fin.read((char*)&buffer, sizeof(buffer));
-        args.shape = seqan3::bin_literal{buffer};
-    }
-
-    fin.close();
+        args.shape = seqan3::bin_literal{header.shape};
 }
 
 // Check number of expression levels, sort expression levels
@@ -331,40 +859,45 @@ void check_fpr(uint8_t const number_expression_thresholds, std::vector<double> &
     }
 }
 
-// Calculate expression thresholds and sizes
+// Calculate expression thresholds and sizes based on a histogram of the minimiser counts, histogram[c] is the number of
+// minimisers occurring c times.
 void get_expression_thresholds(uint8_t const number_expression_thresholds,
-                           robin_hood::unordered_node_map<uint64_t, uint16_t> const & hash_table,
+                           std::vector<uint64_t> const & histogram,
                            std::vector<uint16_t> & expression_thresholds, std::vector<uint64_t> & sizes,
-                           robin_hood::unordered_set<uint64_t> const & genome, uint8_t cutoff, bool all = true)
+                           uint8_t cutoff)
 {
-    // Calculate expression thresholds by taking median recursively
-    std::vector<uint16_t> counts;
-    for (auto && elem : hash_table)
+    // Calculate expression thresholds by taking median recursively. The positions are increasing, so the count at a
+    // position in the sorted counts is found by one pass over the cumulative histogram.
+    std::size_t const number_of_counts = std::accumulate(histogram.begin(), histogram.end(), std::size_t{0});
+    std::size_t count_value{0};
+    std::size_t counts_up_to_value{histogram.empty() ? 0 : histogram[0]};
+    auto count_at = [&] (std::size_t const pos)
     {
-        if (all | genome.contains(elem.first))
-            counts.push_back(elem.second);
-    }
+        while ((counts_up_to_value <= pos) && (count_value + 1 < histogram.size()))
+            counts_up_to_value += histogram[++count_value];
+        return count_value;
+    };
 
     std::size_t dev{2};
     std::size_t prev_pos{0};
     auto prev_exp{0};
     auto exp{0};
-    auto max_elem = *std::max_element(counts.begin(), counts.end());
+    auto max_elem = histogram.size() - 1;
+    while ((max_elem > 0) && (histogram[max_elem] == 0))
+        --max_elem;
     // Zero Level = cutoff + 1
     expression_thresholds.push_back(cutoff + 1);
     // First Level
-    std::nth_element(counts.begin() + prev_pos, counts.begin() +  prev_pos + counts.size()/dev, counts.end());
-    exp = counts[prev_pos + counts.size()/dev];
-    prev_pos = prev_pos + counts.size()/dev;
+    exp = count_at(prev_pos + number_of_counts/dev);
+    prev_pos = prev_pos + number_of_counts/dev;
     dev = dev*2;
     expression_thresholds.push_back(exp);
     sizes.push_back(prev_pos);
 
-    while((expression_thresholds.size() < number_expression_thresholds) & (prev_exp < max_elem) & (dev < counts.size()))
+    while((expression_thresholds.size() < number_expression_thresholds) & (prev_exp < max_elem) & (dev < number_of_counts))
     {
-        std::nth_element(counts.begin() + prev_pos, counts.begin() +  prev_pos + counts.size()/dev, counts.end());
-        exp = counts[prev_pos + counts.size()/dev];
-        prev_pos = prev_pos + counts.size()/dev;
+        exp = count_at(prev_pos + number_of_counts/dev);
+        prev_pos = prev_pos + number_of_counts/dev;
         dev = dev*2;
 
         // If expression does not change compared to previous one, do not store it again as an expression threshold.
@@ -380,83 +913,343 @@ void get_expression_thresholds(uint8_t const number_expression_thresholds,
     // In case not all levels have a threshold, give the last levels a maximal threshold, which can not be met by any minimiser.
     while(expression_thresholds.size() < number_expression_thresholds)
         expression_thresholds.push_back(max_elem + 1);
-    counts.clear();
+}
+
+// Calculate expression thresholds and sizes
+void get_expression_thresholds(uint8_t const number_expression_thresholds,
+                           flat_counter_table<uint16_t> const & hash_table,
+                           std::vector<uint16_t> & expression_thresholds, std::vector<uint64_t> & sizes,
+                           minimiser_set const & genome, uint8_t cutoff, bool all = true)
+{
+    std::vector<uint64_t> histogram(65535, 0);
+    for (auto && elem : hash_table)
+    {
+        if (all | genome.contains(elem.first))
+            histogram[elem.second]++;
+    }
+    get_expression_thresholds(number_expression_thresholds, histogram, expression_thresholds, sizes, cutoff);
+}
+
+// Count the minimisers of a minimiser file for every count, if all is false only minimisers of the genome. The blocks of
+// the file are decoded by several threads, which count in their own histograms.
+void minimiser_file_histogram(minimiser_file_reader const & fin, std::vector<uint64_t> & histogram,
+                              minimiser_set const & genome, bool const all, uint8_t const threads)
+{
+    histogram.assign(65535, 0);
+
+    #pragma omp parallel num_threads(threads)
+    {
+        std::vector<uint64_t> minimisers{};
+        std::vector<uint16_t> counts{};
+        std::vector<uint64_t> thread_histogram(histogram.size(), 0);
+
+        #pragma omp for schedule(dynamic)
+        for (size_t b = 0; b < fin.number_of_blocks(); ++b)
+        {
+            fin.read_block(b, minimisers, counts);
+            for (size_t r = 0; r < minimisers.size(); ++r)
+            {
+                if (all | genome.contains(minimisers[r]))
+                    thread_histogram[counts[r]]++;
+            }
+        }
+
+        #pragma omp critical
+        for (size_t c = 0; c < histogram.size(); ++c)
+            histogram[c] += thread_histogram[c];
+    }
 }
 
 // Estimate the file size for every expression level, necessary when samplewise=false, because then it is completly
 // unclear how many minimisers are to store per file.
 void get_filsize_per_expression_level(std::filesystem::path filename, uint8_t const number_expression_thresholds,
                                       std::vector<uint16_t> const & expression_thresholds, std::vector<uint64_t> & sizes,
-                                      robin_hood::unordered_set<uint64_t> const & genome, bool all = true)
-{
-    std::ifstream fin;
-    uint8_t small_buffer;
-    uint32_t window;
-    uint64_t buffer;
-    fin.open(filename, std::ios::binary);
-    fin.read((char*)&buffer, sizeof(buffer));
-    fin.read((char*)&small_buffer, sizeof(small_buffer));
-    fin.read((char*)&small_buffer, sizeof(small_buffer));
-    fin.read((char*)&window, sizeof(window));
-    fin.read((char*)&buffer, sizeof(buffer));
-    bool ungapped;
-    fin.read((char*)&ungapped, sizeof(ungapped));
-    if (!ungapped)
-    {
-        fin.read((char*)&buffer, sizeof(buffer));
-    }
-
-    uint64_t minimiser;
-    uint16_t minimiser_count;
+                                      minimiser_set const & genome, bool all = true, uint8_t const threads = 1)
+{
     sizes.assign(number_expression_thresholds, 0);
 
-    while(fin.read((char*)&minimiser, sizeof(minimiser)))
+    // Without a genome the histogram stored in the file is sufficient.
+    minimiser_file_reader fin{filename};
+    std::vector<uint64_t> histogram{};
+    if (!all || !fin.read_histogram(histogram))
+        minimiser_file_histogram(fin, histogram, genome, all, threads);
+
+    // Find the level with the smallest greater value than the minimiser occurrence, in the level before that the
+    // minimiser is going to be stored.
+    for (size_t c = 0; c < histogram.size(); ++c)
     {
-        fin.read((char*)&minimiser_count, sizeof(minimiser_count));
-        if (all | genome.contains(minimiser))
-        {
-            // Find the level with the smallest greater value than the minimiser occurrence, in the level before that the
-            // minimiser is going to be stored.
-            auto p = std::upper_bound(expression_thresholds.begin(), expression_thresholds.end(), minimiser_count);
-            if(p != expression_thresholds.begin())
-                sizes[(p-expression_thresholds.begin())-1]++;
-        }
+        auto p = std::upper_bound(expression_thresholds.begin(), expression_thresholds.end(), c);
+        if ((histogram[c] > 0) && (p != expression_thresholds.begin()))
+            sizes[(p-expression_thresholds.begin())-1] += histogram[c];
     }
+}
 
-    fin.close();
+// The level a minimiser is stored in, the greatest level whose expression threshold it reaches, or -1 if it reaches none.
+inline int expression_level(std::vector<uint16_t> const & expression_thresholds, uint16_t const minimiser_count)
+{
+    for (int j = expression_thresholds.size() - 1; j >= 0 ; --j)
+    {
+        if (minimiser_count >= expression_thresholds[j])
+            return j;
+    }
+    return -1;
 }
 
-// Actual ibf construction
-template<bool samplewise, bool minimiser_files_given = true>
-void ibf_helper(std::vector<std::filesystem::path> const & minimiser_files,
-                std::vector<double> const & fprs,
-                estimate_ibf_arguments & ibf_args, std::vector<uint8_t> & cutoffs = {},
-                size_t num_hash = 1, std::filesystem::path expression_by_genome_file = "",
-                minimiser_arguments const & minimiser_args = {})
+// The position of minHash in a bin of an IBF for its first hash function, computed like
+// seqan3::interleaved_bloom_filter does. It is only used to order insertions, so a different computation in seqan3 would
+// only make the order less favourable.
+inline uint64_t ibf_position(uint64_t const minHash, uint64_t const bin_size, int const hash_shift) noexcept
 {
+    uint64_t h = minHash * 13572355802537770549ULL;
+    h ^= h >> hash_shift;
+    h *= 11400714819323198485ULL;
+    return static_cast<uint64_t>((static_cast<__uint128_t>(h) * static_cast<__uint128_t>(bin_size)) >> 64);
+}
 
-    size_t num_files;
-    if constexpr (minimiser_files_given)
-        num_files = minimiser_files.size();
+// Insert minimisers into bin of ibf and clear them. With one hash function, the minimisers are sorted by their position
+// in the IBF first, so the bit array is filled from the beginning to the end instead of at random. With several hash
+// functions, the bits of a minimiser are spread over the whole bin, so sorting does not help.
+void insert_sorted(seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed> & ibf,
+                   std::vector<uint64_t> & minimisers, size_t const bin)
+{
+    if (ibf.hash_function_count() == 1)
+    {
+        uint64_t const bin_size = ibf.bin_size();
+        int const hash_shift = std::countl_zero(bin_size);
+        std::vector<std::pair<uint64_t, uint64_t>> positions(minimisers.size());
+        for (size_t i = 0; i < minimisers.size(); ++i)
+            positions[i] = {ibf_position(minimisers[i], bin_size, hash_shift), minimisers[i]};
+        std::sort(positions.begin(), positions.end());
+        for (auto && [position, minHash] : positions)
+            ibf.emplace(minHash, seqan3::bin_index{bin});
+    }
     else
-        num_files = minimiser_args.samples.size();
+    {
+        for (uint64_t const minHash : minimisers)
+            ibf.emplace(minHash, seqan3::bin_index{bin});
+    }
+    minimisers.clear();
+}
 
-    std::vector<std::vector<uint16_t>> expressions{};
-    std::vector<std::vector<uint64_t>> sizes{};
-    sizes.assign(num_files, {});
+// The minimisers to insert into one bin of the IBFs, collected per level and inserted by insert_sorted, if a batch is
+// full or flush() is called. The bins of 64 samples share the words of the IBFs, so inserting holds the group_mutex of
+// the 64 bins containing bin, i.e. only one sample of a group inserts at a time. If the group is busy when a batch is
+// full, the batch keeps growing and is only inserted while waiting for the group once it reached max_batch_size, so
+// counting continues meanwhile. If an insert_mutex is given, it is held shared while inserting, so the IBFs can be
+// stored while holding it exclusively.
+class ibf_batches
+{
+public:
+    static constexpr size_t batch_size{size_t{1} << 16};
+    static constexpr size_t max_batch_size{8 * batch_size};
 
-    bool const calculate_cutoffs = cutoffs.empty();
+    ibf_batches(std::vector<seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed>> & ibfs_,
+                size_t const bin_, std::mutex & group_mutex_, std::shared_mutex * insert_mutex_ = nullptr) :
+        ibfs{ibfs_}, bin{bin_}, group_mutex{group_mutex_}, insert_mutex{insert_mutex_}, batches(ibfs_.size())
+    {}
 
-    robin_hood::unordered_set<uint64_t> include_set_table; // Storage for minimisers in include file
-    robin_hood::unordered_set<uint64_t> exclude_set_table; // Storage for minimisers in exclude file
-    if constexpr(samplewise)
+    void push(size_t const level, uint64_t const minHash)
     {
-        std::vector<uint16_t> zero_vector(ibf_args.number_expression_thresholds);
-        for (unsigned j = 0; j < num_files; j++)
-            expressions.push_back(zero_vector);
+        batches[level].push_back(minHash);
+        if (batches[level].size() % batch_size == 0)
+            insert(level, batches[level].size() < max_batch_size);
+    }
 
+    void flush()
+    {
+        for (size_t j = 0; j < batches.size(); ++j)
+            insert(j, false);
     }
-    if constexpr (!minimiser_files_given)
+
+private:
+    std::vector<seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed>> & ibfs;
+    size_t bin;
+    std::mutex & group_mutex;
+    std::shared_mutex * insert_mutex;
+    std::vector<std::vector<uint64_t>> batches;
+
+    // Insert the batch of level. If try_only is set, nothing is inserted while another sample of the group inserts.
+    void insert(size_t const level, bool const try_only)
+    {
+        if (batches[level].empty())
+            return;
+        std::shared_lock<std::shared_mutex> lock{};
+        if (insert_mutex != nullptr)
+            lock = std::shared_lock<std::shared_mutex>{*insert_mutex};
+        std::unique_lock<std::mutex> group_lock{group_mutex, std::defer_lock};
+        if (try_only)
+        {
+            if (!group_lock.try_lock())
+                return;
+        }
+        else
+        {
+            group_lock.lock();
+        }
+        insert_sorted(ibfs[level], batches[level], bin);
+    }
+};
+
+// Insert the minimisers of one minimiser file into bin of the IBFs by several threads. The blocks of the file are decoded
+// in parallel and their minimisers are sorted into one batch per level. Inserting into the same IBF from several threads
+// is not safe, so like the shards in fill_hash_table_parallel, a level is only filled by the thread holding its lock.
+template <typename level_of_t>
+void insert_minimiser_file_parallel(minimiser_file_reader const & fin,
+                                    std::vector<seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed>> & ibfs,
+                                    size_t const bin, level_of_t && level_of, uint8_t const threads)
+{
+    std::vector<std::mutex> locks(ibfs.size());
+
+    #pragma omp parallel num_threads(threads)
+    {
+        std::vector<uint64_t> minimisers{};
+        std::vector<uint16_t> counts{};
+        std::vector<std::vector<uint64_t>> batch(ibfs.size());
+        int const t = omp_get_thread_num();
+
+        #pragma omp for schedule(dynamic)
+        for (size_t b = 0; b < fin.number_of_blocks(); ++b)
+        {
+            fin.read_block(b, minimisers, counts);
+            for (size_t r = 0; r < minimisers.size(); ++r)
+            {
+                int const j = level_of(counts[r]);
+                if (j >= 0)
+                    batch[j].push_back(minimisers[r]);
+            }
+
+            // Levels locked by other threads are skipped first and waited for afterwards, threads start at different
+            // levels.
+            for_each_locked(ibfs.size(), t, batch, [&] (size_t const j) -> std::mutex & { return locks[j]; },
+                            [&] (size_t const j) { insert_sorted(ibfs[j], batch[j], bin); });
+        }
+    }
+}
+
+// Estimate the number of minimisers stored per level for every sample by an additional pass over its sequence files.
+// A count-min sketch counts the minimisers and for the cutoff and every expression threshold a HyperLogLog sketch
+// estimates the number of distinct minimisers reaching it. The count-min sketch can not count beyond 255, so the number
+// of minimisers reaching greater expression thresholds is extrapolated from the greatest threshold it can count.
+void estimate_sizes(estimate_ibf_arguments const & args,
+                    minimiser_arguments const & minimiser_args,
+                    std::vector<std::filesystem::path> const & sequence_files,
+                    minimiser_set const & include_set_table,
+                    minimiser_set const & exclude_set_table,
+                    std::vector<uint8_t> const & cutoffs,
+                    bool const samplewise,
+                    std::vector<std::vector<uint64_t>> & sizes)
+{
+    bool const only_include = (minimiser_args.include_file != "");
+    size_t const sketch_bytes = minimiser_args.size_sketch_memory * 1024 * 1024;
+    size_t const number_of_levels = args.number_expression_thresholds;
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < minimiser_args.samples.size(); ++i)
+    {
+        // The first threshold is passing the cutoff, with given expression thresholds these follow. Minimisers not
+        // passing the cutoff are not stored, even if they reach an expression threshold.
+        std::vector<unsigned> thresholds{cutoffs[i] + 1u};
+        if (!samplewise)
+        {
+            for (uint16_t const expression_threshold : args.expression_thresholds)
+                thresholds.push_back(std::max<unsigned>(cutoffs[i] + 1u, expression_threshold));
+        }
+        std::vector<hyperloglog> distinct(thresholds.size());
+        count_min_sketch sketch{sketch_bytes};
+
+        unsigned const file_iterator = std::accumulate(minimiser_args.samples.begin(),
+                                                       minimiser_args.samples.begin() + i, 0);
+        std::vector<uint64_t> minimisers{};
+        for (unsigned f = file_iterator; f < file_iterator + minimiser_args.samples[i]; ++f)
+        {
+            seqan3::sequence_file_input<my_traits, seqan3::fields<seqan3::field::seq>> fin{sequence_files[f]};
+            for (auto & [seq] : fin)
+            {
+                compute_minimisers(args, seq, minimisers);
+                filter_minimisers(minimisers, include_set_table, exclude_set_table, only_include);
+                for (uint64_t const minHash : minimisers)
+                {
+                    // A count of 256 means at least 256, so it only reaches thresholds up to 256.
+                    unsigned const minimiser_count = sketch.increment(minHash) + 1u;
+                    for (size_t t = 0; t < thresholds.size(); ++t)
+                    {
+                        if ((minimiser_count >= thresholds[t]) && (thresholds[t] <= 256))
+                            distinct[t].add(minHash);
+                    }
+                }
+            }
+        }
+
+        std::vector<double> reaching(thresholds.size());
+        size_t counted{0}; // The greatest threshold counted by the sketch, thresholds are sorted
+        for (size_t t = 0; t < thresholds.size(); ++t)
+        {
+            if (thresholds[t] <= 256)
+            {
+                reaching[t] = distinct[t].estimate();
+                counted = t;
+            }
+            else
+            {
+                reaching[t] = reaching[counted] * thresholds[counted] / thresholds[t];
+            }
+        }
+
+        sizes[i].clear();
+        if (samplewise)
+        {
+            // Like the estimate based on the file size, but based on the number of minimisers passing the cutoff.
+            uint64_t diff{1};
+            for (size_t j = 0; j + 1 < number_of_levels; j++)
+            {
+                diff = diff * 2;
+                sizes[i].push_back(reaching[0] / diff);
+            }
+            sizes[i].push_back(reaching[0] / diff);
+        }
+        else
+        {
+            // Level j stores the minimisers reaching expression threshold j, but not j + 1.
+            for (size_t j = 0; j < number_of_levels; j++)
+            {
+                double const next = (j + 1 < number_of_levels) ? reaching[j + 2] : 0.0;
+                sizes[i].push_back(std::max(0.0, reaching[j + 1] - next));
+            }
+        }
+    }
+}
+
+// Actual ibf construction
+template<bool samplewise, bool minimiser_files_given = true>
+void ibf_helper(std::vector<std::filesystem::path> const & minimiser_files,
+                std::vector<double> const & fprs,
+                estimate_ibf_arguments & ibf_args, std::vector<uint8_t> & cutoffs = {},
+                size_t num_hash = 1, std::filesystem::path expression_by_genome_file = "",
+                minimiser_arguments const & minimiser_args = {}, uint8_t const levels_in_memory = 0)
+{
+
+    size_t num_files;
+    if constexpr (minimiser_files_given)
+        num_files = minimiser_files.size();
+    else
+        num_files = minimiser_args.samples.size();
+
+    std::vector<std::vector<uint16_t>> expressions{};
+    std::vector<std::vector<uint64_t>> sizes{};
+    sizes.assign(num_files, {});
+
+    bool const calculate_cutoffs = cutoffs.empty();
+
+    minimiser_set include_set_table; // Storage for minimisers in include file
+    minimiser_set exclude_set_table; // Storage for minimisers in exclude file
+    if constexpr(samplewise)
+    {
+        std::vector<uint16_t> zero_vector(ibf_args.number_expression_thresholds);
+        for (unsigned j = 0; j < num_files; j++)
+            expressions.push_back(zero_vector);
+
+    }
+    if constexpr (!minimiser_files_given)
     {
         if (minimiser_args.include_file != "")
             get_include_set_table(ibf_args, minimiser_args.include_file, include_set_table);
@@ -469,8 +1262,12 @@ void ibf_helper(std::vector<std::filesystem::path> const & minimiser_files,
 
     size_t const chunk_size = std::clamp<size_t>(std::bit_ceil(num_files / ibf_args.threads), 8u, 64u);
 
+    // If there are fewer samples than threads, the samples are processed one after another and the reads or the blocks
+    // of the minimiser file of one sample are distributed over all threads instead.
+    uint8_t const sample_threads = (num_files < ibf_args.threads) ? ibf_args.threads : 1;
+
     // If expression_thresholds should only be depending on minimsers in a certain genome file, genome is created.
-    robin_hood::unordered_set<uint64_t> genome{};
+    minimiser_set genome{};
     if (expression_by_genome_file != "")
         get_include_set_table(ibf_args, expression_by_genome_file, genome);
     bool const expression_by_genome = (expression_by_genome_file == "");
@@ -517,7 +1314,7 @@ void ibf_helper(std::vector<std::filesystem::path> const & minimiser_files,
         else if constexpr (minimiser_files_given)
         {
             get_filsize_per_expression_level(minimiser_files[i], ibf_args.number_expression_thresholds, ibf_args.expression_thresholds, sizes[i],
-                                             genome, expression_by_genome);
+                                             genome, expression_by_genome, ibf_args.threads);
         }
         else
         {
@@ -531,10 +1328,67 @@ void ibf_helper(std::vector<std::filesystem::path> const & minimiser_files,
         }
     }
 
+    // Size the IBFs by estimates of the number of minimisers instead of the file sizes.
+    if constexpr (!minimiser_files_given)
+    {
+        if (minimiser_args.size_sketch_memory > 0)
+        {
+            estimate_sizes(ibf_args, minimiser_args, minimiser_files, include_set_table, exclude_set_table, cutoffs,
+                           samplewise, sizes);
+        }
+    }
+
+    // With several partitions, the experiments are sorted by their size and split into partitions of the same number of
+    // experiments. Every partition has its own IBF per level, so small experiments do not get the bin size of large ones.
+    size_t const number_of_partitions = std::clamp<size_t>(ibf_args.partitions, 1u, num_files);
+    std::vector<std::vector<size_t>> partitions(number_of_partitions);
+    std::vector<size_t> partition_of(num_files, 0);
+    {
+        std::vector<uint64_t> total_sizes(num_files);
+        for (unsigned i = 0; i < num_files; i++)
+            total_sizes[i] = std::accumulate(sizes[i].begin(), sizes[i].end(), uint64_t{0});
+        std::vector<size_t> order(num_files);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&] (size_t const a, size_t const b)
+        {
+            return total_sizes[a] < total_sizes[b];
+        });
+        for (size_t p = 0; p < number_of_partitions; p++)
+        {
+            partitions[p].assign(order.begin() + p * num_files / number_of_partitions,
+                                 order.begin() + (p + 1) * num_files / number_of_partitions);
+            // Within a partition the experiments keep their order.
+            std::sort(partitions[p].begin(), partitions[p].end());
+            for (size_t const i : partitions[p])
+                partition_of[i] = p;
+        }
+    }
+
+    std::filesystem::path const partitions_file = std::string{ibf_args.path_out} + "IBF_Partitions.partitions";
+    if (number_of_partitions > 1)
+    {
+        std::ofstream outfile{partitions_file};
+        for (auto && partition : partitions)
+        {
+            for (size_t const i : partition)
+                outfile << i << " ";
+            outfile << "\n";
+        }
+        outfile << "/\n";
+    }
+    else
+    {
+        std::filesystem::remove(partitions_file);
+    }
+
     std::ofstream outfile_fpr;
     outfile_fpr.open(std::string{ibf_args.path_out} +  "IBF_FPRs.fprs"); // File to store actual false positive rates per experiment.
-    // Create IBFs
-    std::vector<seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed>> ibfs;
+    // Determine the sizes of the IBFs
+    if (!ibf_args.bin_sizes.empty() && (ibf_args.bin_sizes.size() != ibf_args.number_expression_thresholds))
+        throw std::invalid_argument{"Error. Please give one bin size for every expression level."};
+    if (std::ranges::find(ibf_args.bin_sizes, 0u) != ibf_args.bin_sizes.end())
+        throw std::invalid_argument{"Error. The bin sizes have to be greater than 0."};
+    std::vector<std::vector<uint64_t>> bin_sizes(number_of_partitions);
     for (unsigned j = 0; j < ibf_args.number_expression_thresholds; j++)
     {
         uint64_t size{0};
@@ -549,15 +1403,24 @@ void ibf_helper(std::vector<std::filesystem::path> const & minimiser_files,
             std::to_string(ibf_args.expression_thresholds[j]) +
             std::string(" on.\n")};
         }
-        // m = -hn/ln(1-p^(1/h))
-        size = static_cast<uint64_t>((-1.0*num_hash*((1.0*size)/num_files))/(std::log(1.0-std::pow(fprs[j], 1.0/num_hash))));
-        ibfs.push_back(seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed>(
-                     seqan3::bin_count{num_files}, seqan3::bin_size{size},
-                     seqan3::hash_function_count{num_hash}));
+        for (size_t p = 0; p < number_of_partitions; p++)
+        {
+            uint64_t partition_size{0};
+            for (size_t const i : partitions[p])
+                partition_size = partition_size + sizes[i][j];
+            // m = -hn/ln(1-p^(1/h))
+            partition_size = static_cast<uint64_t>((-1.0*num_hash*((1.0*partition_size)/partitions[p].size()))/
+                                                   (std::log(1.0-std::pow(fprs[j], 1.0/num_hash))));
+            if (ibf_args.bin_sizes.empty())
+                bin_sizes[p].push_back(std::max<uint64_t>(partition_size, 1u));
+            else
+                bin_sizes[p].push_back(ibf_args.bin_sizes[j]);
+        }
 
         for (unsigned i = 0; i < num_files; i++)
         {
-            double fpr = std::pow(1.0- std::pow(1.0-(1.0/size), num_hash*sizes[i][j]), num_hash);
+            uint64_t const bin_size = bin_sizes[partition_of[i]][j];
+            double fpr = std::pow(1.0- std::pow(1.0-(1.0/bin_size), num_hash*sizes[i][j]), num_hash);
             outfile_fpr << fpr << " ";
         }
         outfile_fpr << "\n";
@@ -565,91 +1428,297 @@ void ibf_helper(std::vector<std::filesystem::path> const & minimiser_files,
     outfile_fpr << "/\n";
     outfile_fpr.close();
 
-    // Add minimisers to ibf
-    #pragma omp parallel for schedule(dynamic, chunk_size)
-    for (unsigned i = 0; i < num_files; i++)
+    // With --max-memory the memory is shared by all samples, which are processed at the same time.
+    size_t const sample_memory = minimiser_args.max_memory * 1024 * 1024 /
+                                 ((sample_threads == 1) ? std::min<size_t>(ibf_args.threads, num_files) : 1);
+
+    // If levels_in_memory is set for minimiser files, only this number of levels is built at the same time. The minimiser
+    // files are read again for every group of levels.
+    size_t const levels_per_pass = (minimiser_files_given && (levels_in_memory > 0)) ?
+                                   levels_in_memory : ibf_args.number_expression_thresholds;
+    std::vector<seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed>> ibfs(ibf_args.number_expression_thresholds);
+    auto ibf_file = [&] (size_t const p, size_t const j)
     {
-        robin_hood::unordered_node_map<uint64_t, uint16_t> hash_table{}; // Storage for minimisers
-        // Create a smaller cutoff table to save RAM, this cutoff table is only used for constructing the hash table
-        // and afterwards discarded.
-        robin_hood::unordered_node_map<uint64_t, uint8_t>  cutoff_table;
-        std::vector<uint16_t> expression_thresholds;
+        std::filesystem::path filename;
+        if constexpr(samplewise)
+             filename = ibf_args.path_out.string() + "IBF_Level_" + std::to_string(j);
+        else
+            filename = ibf_args.path_out.string() + "IBF_" + std::to_string(ibf_args.expression_thresholds[j]);
+        filename += partition_suffix(p, number_of_partitions);
+        return filename;
+    };
 
-        // Fill hash table with minimisers.
-        if constexpr (minimiser_files_given)
+    // With checkpoints, the IBFs of the current partition and the finished samples are stored regularly, so an
+    // interrupted build can be resumed. The samples insert while holding insert_mutex shared, a checkpoint is written
+    // while holding it exclusively. A finished sample is only stored in a checkpoint containing its minimisers, samples
+    // being inserted during a checkpoint are inserted again after resuming, which does not change the IBFs.
+    bool const checkpoints = !minimiser_files_given && ((minimiser_args.checkpoint_interval > 0) || minimiser_args.resume);
+    std::filesystem::path const checkpoint_file = std::string{ibf_args.path_out} + "IBF_Checkpoint.samples";
+    std::shared_mutex insert_mutex{};
+    std::vector<size_t> finished_samples{};
+    std::vector<bool> finished(num_files, false);
+    size_t samples_since_checkpoint{0};
+    auto checkpoint_ibf_file = [&] (size_t const p, size_t const j)
+    {
+        return std::filesystem::path{ibf_file(p, j).string() + ".checkpoint"};
+    };
+    auto write_checkpoint = [&] (size_t const p)
+    {
+        for (size_t j = 0; j < ibf_args.number_expression_thresholds; j++)
         {
-            read_binary(minimiser_files[i], hash_table);
+            std::filesystem::path const filename = checkpoint_ibf_file(p, j);
+            store_ibf(ibfs[j], filename.string() + ".tmp");
+            std::filesystem::rename(filename.string() + ".tmp", filename);
         }
-        else
+        std::ofstream outfile{checkpoint_file.string() + ".tmp"};
+        outfile << num_files << " " << static_cast<int>(ibf_args.number_expression_thresholds) << "\n";
+        for (size_t const i : finished_samples)
         {
-            unsigned file_iterator = std::accumulate(minimiser_args.samples.begin(), minimiser_args.samples.begin() + i, 0);
-            for (unsigned f = 0; f < minimiser_args.samples[i]; f++)
+            outfile << i;
+            if constexpr (samplewise)
             {
-               seqan3::sequence_file_input<my_traits, seqan3::fields<seqan3::field::seq>> fin{minimiser_files[file_iterator+f]};
-               fill_hash_table(ibf_args, fin, hash_table, cutoff_table, include_set_table, exclude_set_table,
-                               (minimiser_args.include_file != ""), cutoffs[i]);
+                for (unsigned j = 0; j < ibf_args.number_expression_thresholds; j++)
+                    outfile << " " << expressions[i][j];
             }
-            cutoff_table.clear();
+            outfile << "\n";
         }
+        outfile.close();
+        std::filesystem::rename(checkpoint_file.string() + ".tmp", checkpoint_file);
+    };
 
-        // If set_expression_thresholds_samplewise is not set the expressions as determined by the first file are used for
-        // all files.
-        if constexpr (samplewise)
+    // The IBFs of a checkpoint are only used together with its samples. The IBFs are stored before the samples, so
+    // without the samples file they can be left from an interrupted checkpoint or an older build.
+    bool const resume = checkpoints && minimiser_args.resume && std::filesystem::exists(checkpoint_file);
+    if (resume)
+    {
+        std::ifstream fin{checkpoint_file};
+        size_t checkpoint_files{};
+        size_t checkpoint_levels{};
+        fin >> checkpoint_files >> checkpoint_levels;
+        if ((checkpoint_files != num_files) || (checkpoint_levels != ibf_args.number_expression_thresholds))
         {
-           get_expression_thresholds(ibf_args.number_expression_thresholds,
-                                 hash_table,
-                                 expression_thresholds,
-                                 sizes[i],
-                                 genome,
-                                 cutoffs[i],
-                                 expression_by_genome);
-           expressions[i] = expression_thresholds;
+            throw std::invalid_argument{"Error. The checkpoint " + checkpoint_file.string() + " was written for other "
+                                        "experiments or expression thresholds."};
         }
+        size_t i{};
+        while (fin >> i)
+        {
+            if (i >= num_files)
+                throw std::invalid_argument{"Error. The checkpoint " + checkpoint_file.string() + " is damaged."};
+            if constexpr (samplewise)
+            {
+                expressions[i].resize(ibf_args.number_expression_thresholds);
+                for (unsigned j = 0; j < ibf_args.number_expression_thresholds; j++)
+                    fin >> expressions[i][j];
+            }
+            finished[i] = true;
+            finished_samples.push_back(i);
+        }
+    }
+    else if (checkpoints)
+    {
+        std::filesystem::remove(checkpoint_file);
+        for (size_t p = 0; p < number_of_partitions; p++)
+        {
+            for (size_t j = 0; j < ibf_args.number_expression_thresholds; j++)
+                std::filesystem::remove(checkpoint_ibf_file(p, j));
+        }
+    }
 
-        // Every minimiser is stored in IBF, if it occurence is greater than or equal to the expression level
-        for (auto && elem : hash_table)
+    for (size_t p = 0; p < number_of_partitions; p++)
+    {
+        std::vector<size_t> const & partition = partitions[p];
+        size_t const partition_groups = (partition.size() + 63) / 64;
+        for (size_t first_level = 0; first_level < ibf_args.number_expression_thresholds; first_level += levels_per_pass)
         {
-            for (int j = ibf_args.number_expression_thresholds - 1; j >= 0 ; --j)
+            size_t const last_level = std::min<size_t>(first_level + levels_per_pass, ibf_args.number_expression_thresholds);
+
+            // Create IBFs, or continue with the IBFs of the checkpoint.
+            for (size_t j = first_level; j < last_level; j++)
             {
-                if constexpr (samplewise)
+                if (resume && std::filesystem::exists(checkpoint_ibf_file(p, j)))
                 {
-                    if (elem.second >= expressions[i][j])
+                    load_ibf(ibfs[j], checkpoint_ibf_file(p, j));
+                    if ((ibfs[j].bin_count() != partition.size()) || (ibfs[j].bin_size() != bin_sizes[p][j]))
                     {
-                        ibfs[j].emplace(elem.first, seqan3::bin_index{i});
-                        break;
+                        throw std::invalid_argument{"Error. The checkpoint " + checkpoint_ibf_file(p, j).string() +
+                                                    " does not match the IBF to build."};
                     }
+                    continue;
+                }
+                ibfs[j] = seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed>(
+                          seqan3::bin_count{partition.size()}, seqan3::bin_size{bin_sizes[p][j]},
+                          seqan3::hash_function_count{num_hash});
+            }
+
+            // Add minimisers to ibf. The bins of 64 samples share the words of the IBFs, so the samples are counted in
+            // parallel, but only one sample of a group of 64 bins inserts at a time. With at most 64 samples, inserting
+            // is therefore serialised and does not become faster with more threads, only counting does.
+            std::vector<std::mutex> group_mutexes(partition_groups);
+            #pragma omp parallel for schedule(dynamic, chunk_size) if(sample_threads == 1)
+            for (size_t bin = 0; bin < partition.size(); bin++)
+            {
+                size_t const i = partition[bin];
+                if (finished[i])
+                    continue;
+                std::vector<uint16_t> expression_thresholds;
+
+                // Every minimiser is stored in IBF, if it occurence is greater than or equal to the expression level
+                auto level_of = [&] (uint16_t const minimiser_count)
+                {
+                    for (int j = ibf_args.number_expression_thresholds - 1; j >= 0 ; --j)
+                    {
+                        if constexpr (samplewise)
+                        {
+                            if (minimiser_count >= expressions[i][j])
+                                return j;
+                        }
+                        else
+                        {
+                            if (minimiser_count >= ibf_args.expression_thresholds[j])
+                                return j;
+                        }
+                    }
+                    return -1;
+                };
+                auto level_in_pass = [&] (uint16_t const minimiser_count)
+                {
+                    int const j = level_of(minimiser_count);
+                    return ((j >= static_cast<int>(first_level)) && (j < static_cast<int>(last_level))) ? j : -1;
+                };
+                ibf_batches batches{ibfs, bin, group_mutexes[bin / 64], checkpoints ? &insert_mutex : nullptr};
+                auto insert = [&] (uint64_t const minHash, uint16_t const minimiser_count)
+                {
+                    int const j = level_in_pass(minimiser_count);
+                    if (j >= 0)
+                        batches.push(j, minHash);
+                };
+
+                // Count with bounded memory, the minimisers are never all stored in a hash table.
+                if (!minimiser_files_given && (minimiser_args.max_memory > 0))
+                {
+                    unsigned file_iterator = std::accumulate(minimiser_args.samples.begin(), minimiser_args.samples.begin() + i, 0);
+                    if constexpr (samplewise)
+                    {
+                        // The expression thresholds depend on all counts, so the counted minimisers are stored in a temporary
+                        // file until the thresholds are known.
+                        std::filesystem::path const counts_file = ibf_args.path_out.string() +
+                                                                  std::string{minimiser_files[file_iterator].stem()} + ".counts";
+                        std::vector<uint64_t> histogram(65535, 0);
+                        std::ofstream outfile{counts_file, std::ios::binary};
+                        count_sample_external(ibf_args, minimiser_args, minimiser_files, file_iterator, minimiser_args.samples[i],
+                                              include_set_table, exclude_set_table, cutoffs[i], sample_memory,
+                                              [&] (uint64_t const minHash, uint16_t const minimiser_count)
+                        {
+                            outfile.write(reinterpret_cast<const char*>(&minHash), sizeof(minHash));
+                            outfile.write(reinterpret_cast<const char*>(&minimiser_count), sizeof(minimiser_count));
+                            if (expression_by_genome | genome.contains(minHash))
+                                histogram[minimiser_count]++;
+                        });
+                        outfile.close();
+
+                        get_expression_thresholds(ibf_args.number_expression_thresholds, histogram, expression_thresholds,
+                                                  sizes[i], cutoffs[i]);
+                        expressions[i] = expression_thresholds;
+
+                        std::ifstream fin{counts_file, std::ios::binary};
+                        uint64_t minHash;
+                        uint16_t minimiser_count;
+                        while (fin.read((char*)&minHash, sizeof(minHash)))
+                        {
+                            fin.read((char*)&minimiser_count, sizeof(minimiser_count));
+                            insert(minHash, minimiser_count);
+                        }
+                        fin.close();
+                        std::filesystem::remove(counts_file);
+                    }
+                    else
+                    {
+                        count_sample_external(ibf_args, minimiser_args, minimiser_files, file_iterator, minimiser_args.samples[i],
+                                              include_set_table, exclude_set_table, cutoffs[i], sample_memory, insert);
+                    }
+                }
+                else if constexpr (minimiser_files_given)
+                {
+                    // The minimisers are inserted directly from the mapped minimiser file, without storing them in a hash table.
+                    minimiser_file_reader fin{minimiser_files[i]};
+                    // The expression thresholds are determined in the first pass over the files.
+                    if (samplewise && (first_level == 0))
+                    {
+                        // Without a genome the histogram stored in the file is sufficient.
+                        std::vector<uint64_t> histogram{};
+                        if (!expression_by_genome || !fin.read_histogram(histogram))
+                            minimiser_file_histogram(fin, histogram, genome, expression_by_genome, sample_threads);
+                        get_expression_thresholds(ibf_args.number_expression_thresholds, histogram, expression_thresholds,
+                                                  sizes[i], cutoffs[i]);
+                        expressions[i] = expression_thresholds;
+                    }
+
+                    if (sample_threads == 1)
+                        fin.for_each(insert);
+                    else
+                        insert_minimiser_file_parallel(fin, ibfs, bin, level_in_pass, sample_threads);
                 }
                 else
                 {
-                    if (elem.second >= ibf_args.expression_thresholds[j])
+                    // Fill hash table with minimisers.
+                    flat_counter_table<uint16_t> hash_table{};
+                    unsigned file_iterator = std::accumulate(minimiser_args.samples.begin(), minimiser_args.samples.begin() + i, 0);
+                    fill_hash_table_sample(ibf_args, minimiser_args, minimiser_files, file_iterator, minimiser_args.samples[i],
+                                           hash_table, include_set_table, exclude_set_table, cutoffs[i], sample_threads);
+
+                    // If set_expression_thresholds_samplewise is not set the expressions as determined by the first file are used for
+                    // all files.
+                    if constexpr (samplewise)
                     {
-                        ibfs[j].emplace(elem.first, seqan3::bin_index{i});
-                        break;
+                       get_expression_thresholds(ibf_args.number_expression_thresholds,
+                                             hash_table,
+                                             expression_thresholds,
+                                             sizes[i],
+                                             genome,
+                                             cutoffs[i],
+                                             expression_by_genome);
+                       expressions[i] = expression_thresholds;
+                    }
+
+                    for (auto && elem : hash_table)
+                        insert(elem.first, elem.second);
+                }
+                batches.flush();
+
+                if (checkpoints)
+                {
+                    std::unique_lock lock{insert_mutex};
+                    finished_samples.push_back(i);
+                    if (++samples_since_checkpoint == minimiser_args.checkpoint_interval)
+                    {
+                        write_checkpoint(p);
+                        samples_since_checkpoint = 0;
                     }
                 }
             }
-        }
-    }
 
-    // Store IBFs
-    for (unsigned i = 0; i < ibf_args.number_expression_thresholds; i++)
-    {
-        std::filesystem::path filename;
-        if constexpr(samplewise)
-             filename = ibf_args.path_out.string() + "IBF_Level_" + std::to_string(i);
-        else
-            filename = ibf_args.path_out.string() + "IBF_" + std::to_string(ibf_args.expression_thresholds[i]);
+            // Later checkpoints contain the samples of this partition, so its checkpoint has to contain all of them.
+            if (checkpoints)
+                write_checkpoint(p);
 
-        if (ibf_args.compressed)
-        {
-            seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed> ibf{ibfs[i]};
-            store_ibf(ibf, filename);
-        }
-        else
-        {
-            store_ibf(ibfs[i], filename);
-        }
+            // Store IBFs and free their memory before the next levels are built.
+            for (unsigned i = first_level; i < last_level; i++)
+            {
+                std::filesystem::path const filename = ibf_file(p, i);
 
+                if (ibf_args.compressed)
+                {
+                    seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed> ibf{ibfs[i]};
+                    store_ibf(ibf, filename);
+                }
+                else
+                {
+                    store_ibf(ibfs[i], filename);
+                }
+                ibfs[i] = seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed>{};
+            }
+        }
     }
 
     // Store all expression thresholds per level.
@@ -666,6 +1735,17 @@ void ibf_helper(std::vector<std::filesystem::path> const & minimiser_files,
         outfile << "/\n";
         outfile.close();
     }
+
+    // The index is complete, so the checkpoints are not needed anymore.
+    if (checkpoints)
+    {
+        for (size_t p = 0; p < number_of_partitions; p++)
+        {
+            for (size_t j = 0; j < ibf_args.number_expression_thresholds; j++)
+                std::filesystem::remove(checkpoint_ibf_file(p, j));
+        }
+        std::filesystem::remove(checkpoint_file);
+    }
 }
 
 // Create ibfs
@@ -675,7 +1755,7 @@ std::vector<uint16_t> ibf(std::vector<std::filesystem::path> const & sequence_fi
                           std::filesystem::path const expression_by_genome_file, size_t num_hash)
 {
     // Declarations
-    robin_hood::unordered_node_map<uint64_t, uint16_t> hash_table{}; // Storage for minimisers
+    flat_counter_table<uint16_t> hash_table{}; // Storage for minimisers
     seqan3::concatenated_sequences<seqan3::dna4_vector> sequences; // Storage for sequences in experiment files
 
     check_cutoffs_samples(sequence_files, minimiser_args.paired, minimiser_args.samples, cutoffs);
@@ -713,7 +1793,7 @@ std::vector<uint16_t> ibf(std::vector<std::filesystem::path> const & sequence_fi
 std::vector<uint16_t> ibf(std::vector<std::filesystem::path> const & minimiser_files,
                           estimate_ibf_arguments & ibf_args, std::vector<double> & fpr,
                           std::filesystem::path const expression_by_genome_file,
-                          size_t num_hash)
+                          size_t num_hash, uint8_t const levels_in_memory)
 {
     check_expression(ibf_args.expression_thresholds, ibf_args.number_expression_thresholds, expression_by_genome_file);
     check_fpr(ibf_args.number_expression_thresholds, fpr);
@@ -722,32 +1802,624 @@ std::vector<uint16_t> ibf(std::vector<std::filesystem::path> const & minimiser_f
 
     std::vector<uint8_t> cutoffs{};
     if (ibf_args.samplewise)
-        ibf_helper<true>(minimiser_files, fpr, ibf_args, cutoffs, num_hash, expression_by_genome_file);
+        ibf_helper<true>(minimiser_files, fpr, ibf_args, cutoffs, num_hash, expression_by_genome_file, {},
+                         levels_in_memory);
     else
-        ibf_helper<false>(minimiser_files, fpr, ibf_args, cutoffs, num_hash, expression_by_genome_file);
+        ibf_helper<false>(minimiser_files, fpr, ibf_args, cutoffs, num_hash, expression_by_genome_file, {},
+                          levels_in_memory);
 
     store_args(ibf_args, std::string{ibf_args.path_out} + "IBF_Data");
 
     return ibf_args.expression_thresholds;
 }
 
+// Read a file like IBF_Levels.levels or IBF_FPRs.fprs, which store one line per level with one value per experiment.
+std::vector<std::vector<std::string>> read_level_file(std::filesystem::path const & filename)
+{
+    std::ifstream fin{filename};
+    if (!fin.good() || !fin.is_open())
+        throw std::runtime_error{"Could not open file " + filename.string() + " for reading."};
+    std::vector<std::vector<std::string>> lines{};
+    std::string line{};
+    while (std::getline(fin, line) && (line != "/"))
+    {
+        std::stringstream sstream{line};
+        std::string value{};
+        lines.emplace_back();
+        while (sstream >> value)
+            lines.back().push_back(value);
+    }
+    return lines;
+}
+
+void write_level_file(std::filesystem::path const & filename, std::vector<std::vector<std::string>> const & lines)
+{
+    std::ofstream outfile{filename};
+    for (auto && line : lines)
+    {
+        for (auto && value : line)
+            outfile << value << " ";
+        outfile << "\n";
+    }
+    outfile << "/\n";
+}
+
+// Set the values of the experiments first_bin, first_bin + 1, ... in every line of a level file and write it to outfile.
+// Values after the last experiment are appended.
+template <typename value_t>
+void update_level_file(std::filesystem::path const & filename, size_t const first_bin,
+                       std::vector<std::vector<value_t>> const & values, std::filesystem::path const & outfile)
+{
+    std::vector<std::vector<std::string>> lines = read_level_file(filename);
+    if (lines.size() != values.size())
+        throw std::invalid_argument{"Error. The file " + filename.string() + " does not contain all levels of the index."};
+
+    for (size_t j = 0; j < lines.size(); j++)
+    {
+        if (lines[j].size() < first_bin)
+            throw std::invalid_argument{"Error. The file " + filename.string() + " does not contain all experiments."};
+        lines[j].resize(std::max(lines[j].size(), first_bin + values[j].size()));
+        for (size_t f = 0; f < values[j].size(); f++)
+        {
+            std::stringstream value{};
+            value << values[j][f];
+            lines[j][first_bin + f] = value.str();
+        }
+    }
+    write_level_file(outfile, lines);
+}
+
+// The file of the IBF of level j of an index, or of one of its partitions.
+std::filesystem::path ibf_level_file(estimate_ibf_arguments const & ibf_args, size_t const j,
+                                     std::string const & suffix = "")
+{
+    if (ibf_args.samplewise)
+        return ibf_args.path_out.string() + "IBF_Level_" + std::to_string(j) + suffix;
+    return ibf_args.path_out.string() + "IBF_" + std::to_string(ibf_args.expression_thresholds[j]) + suffix;
+}
+
+// Load the IBF of an index to change it. The bins of a compressed IBF can not be changed, so it is decompressed.
+void load_index_ibf(seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed> & ibf,
+                    estimate_ibf_arguments const & ibf_args, std::filesystem::path const & filename)
+{
+    if (ibf_args.compressed)
+    {
+        seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed> compressed_ibf;
+        load_ibf(compressed_ibf, filename);
+        ibf = seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed>{compressed_ibf};
+    }
+    else
+    {
+        load_ibf(ibf, filename);
+    }
+}
+
+// Store a changed IBF of an index in the layout of the index.
+void store_index_ibf(seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed> const & ibf,
+                     estimate_ibf_arguments const & ibf_args, std::filesystem::path const & filename)
+{
+    if (ibf_args.compressed)
+        store_ibf(seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed>{ibf}, filename);
+    else
+        store_ibf(ibf, filename);
+}
+
+// The changed files of an index are written next to the old ones with the suffix .tmp and only replace them, when all
+// of them are written. If changing the index fails before, the old files are kept and the temporary ones are removed.
+class staged_index_files
+{
+public:
+    staged_index_files() = default;
+    staged_index_files(staged_index_files const &) = delete;
+    staged_index_files & operator=(staged_index_files const &) = delete;
+
+    ~staged_index_files()
+    {
+        std::error_code ec{};
+        for (auto && filename : filenames)
+            std::filesystem::remove(stage_of(filename), ec);
+    }
+
+    //!\brief Returns the temporary file to write instead of filename.
+    std::filesystem::path stage(std::filesystem::path const & filename)
+    {
+        filenames.push_back(filename);
+        return stage_of(filename);
+    }
+
+    //!\brief Replaces the files of the index by the temporary files.
+    void commit()
+    {
+        for (auto && filename : filenames)
+            std::filesystem::rename(stage_of(filename), filename);
+        filenames.clear();
+    }
+
+private:
+    std::vector<std::filesystem::path> filenames{};
+
+    static std::filesystem::path stage_of(std::filesystem::path const & filename)
+    {
+        return filename.string() + ".tmp";
+    }
+};
+
+// Determine the expression thresholds of an experiment to be added to an index and its number of minimisers per level.
+void experiment_levels(std::filesystem::path const & minimiser_file, estimate_ibf_arguments const & ibf_args,
+                       std::vector<uint16_t> & expressions, std::vector<uint64_t> & sizes)
+{
+    size_t const number_of_levels = ibf_args.number_expression_thresholds;
+    minimiser_file_reader fin{minimiser_file};
+    minimiser_file_header const & header = fin.header();
+    if ((header.k != ibf_args.k) || (header.window != ibf_args.w_size.get()) || (header.seed != ibf_args.s.get()) ||
+        (header.ungapped != ibf_args.shape.all()) || (!header.ungapped && (header.shape != ibf_args.shape.to_ulong())))
+    {
+        throw std::invalid_argument{"Error. The minimiser file " + minimiser_file.string() + " was created with other "
+                                    "minimiser arguments than the index."};
+    }
+
+    std::vector<uint64_t> histogram{};
+    if (!fin.read_histogram(histogram))
+        minimiser_file_histogram(fin, histogram, {}, true, ibf_args.threads);
+    if (ibf_args.samplewise)
+    {
+        std::vector<uint64_t> level_sizes{};
+        get_expression_thresholds(number_of_levels, histogram, expressions, level_sizes, header.cutoff);
+        // For a single level a second threshold is determined, which is not part of the index.
+        expressions.resize(number_of_levels);
+    }
+    else
+    {
+        expressions = ibf_args.expression_thresholds;
+    }
+
+    sizes.assign(number_of_levels, 0);
+    for (size_t c = 0; c < histogram.size(); c++)
+    {
+        int const j = expression_level(expressions, std::min<size_t>(c, 65535));
+        if (j >= 0)
+            sizes[j] += histogram[c];
+    }
+}
+
+// The false positive rate of a bin containing size minimisers.
+inline double bin_fpr(seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed> const & ibf,
+                      uint64_t const size)
+{
+    size_t const num_hash = ibf.hash_function_count();
+    return std::pow(1.0- std::pow(1.0-(1.0/ibf.bin_size()), num_hash*size), num_hash);
+}
+
+// Append experiments to an existing index
+std::vector<uint16_t> append(std::vector<std::filesystem::path> const & minimiser_files,
+                             estimate_ibf_arguments & ibf_args)
+{
+    load_args(ibf_args, std::string{ibf_args.path_out} + "IBF_Data");
+    if (std::filesystem::exists(std::string{ibf_args.path_out} + "IBF_Partitions.partitions"))
+        throw std::invalid_argument{"Error. Experiments can not be appended to a partitioned index."};
+    size_t const number_of_levels = ibf_args.number_expression_thresholds;
+    size_t const number_of_files = minimiser_files.size();
+
+    std::vector<std::vector<uint16_t>> expressions(number_of_files);
+    std::vector<std::vector<uint64_t>> sizes(number_of_files);
+    for (size_t f = 0; f < number_of_files; f++)
+        experiment_levels(minimiser_files[f], ibf_args, expressions[f], sizes[f]);
+
+    staged_index_files staged{};
+    size_t first_bin{0};
+    std::vector<std::vector<double>> fprs(number_of_levels);
+    for (size_t j = 0; j < number_of_levels; j++)
+    {
+        seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed> ibf;
+        load_index_ibf(ibf, ibf_args, ibf_level_file(ibf_args, j));
+        first_bin = ibf.bin_count();
+        size_t const last_bin = first_bin + number_of_files;
+        ibf.increase_bin_number_to(seqan3::bin_count{last_bin});
+
+        // Like in ibf_helper, the bins of 64 experiments share words and are filled by the same thread.
+        #pragma omp parallel for schedule(dynamic) num_threads(ibf_args.threads)
+        for (size_t group = first_bin / 64; group < (last_bin + 63) / 64; group++)
+        {
+            std::vector<uint64_t> minimisers{};
+            for (size_t bin = std::max(first_bin, group * 64); bin < std::min(last_bin, (group + 1) * 64); bin++)
+            {
+                size_t const f = bin - first_bin;
+                minimiser_file_reader fin{minimiser_files[f]};
+                fin.for_each([&] (uint64_t const minHash, uint16_t const minimiser_count)
+                {
+                    if (expression_level(expressions[f], minimiser_count) == static_cast<int>(j))
+                        minimisers.push_back(minHash);
+                });
+                insert_sorted(ibf, minimisers, bin);
+            }
+        }
+        store_index_ibf(ibf, ibf_args, staged.stage(ibf_level_file(ibf_args, j)));
+
+        for (size_t f = 0; f < number_of_files; f++)
+            fprs[j].push_back(bin_fpr(ibf, sizes[f][j]));
+    }
+
+    std::filesystem::path const fpr_file = std::string{ibf_args.path_out} + "IBF_FPRs.fprs";
+    update_level_file(fpr_file, first_bin, fprs, staged.stage(fpr_file));
+    if (ibf_args.samplewise)
+    {
+        std::vector<std::vector<uint16_t>> levels(number_of_levels);
+        for (size_t j = 0; j < number_of_levels; j++)
+        {
+            for (size_t f = 0; f < number_of_files; f++)
+                levels[j].push_back(expressions[f][j]);
+        }
+        std::filesystem::path const levels_file = std::string{ibf_args.path_out} + "IBF_Levels.levels";
+        update_level_file(levels_file, first_bin, levels, staged.stage(levels_file));
+    }
+
+    // Experiment names are only stored, if the index contains them.
+    std::filesystem::path const stored_files = std::string{ibf_args.path_out} + "Stored_Files.txt";
+    if (std::filesystem::exists(stored_files))
+    {
+        std::filesystem::path const staged_stored_files = staged.stage(stored_files);
+        std::filesystem::copy_file(stored_files, staged_stored_files, std::filesystem::copy_options::overwrite_existing);
+        std::ofstream outfile{staged_stored_files, std::ios::app};
+        for (auto && file : minimiser_files)
+            outfile << file << "\n";
+    }
+
+    staged.commit();
+
+    return ibf_args.expression_thresholds;
+}
+
+// Clear a bin of an existing index and insert the minimisers of a replacement experiment
+std::vector<uint16_t> replace(size_t const bin, std::filesystem::path const & minimiser_file,
+                              estimate_ibf_arguments & ibf_args)
+{
+    load_args(ibf_args, std::string{ibf_args.path_out} + "IBF_Data");
+    size_t const number_of_levels = ibf_args.number_expression_thresholds;
+    bool const replacement = !minimiser_file.empty();
+
+    // The minimisers of the replacement are read once and sorted into their levels.
+    std::vector<uint16_t> expressions{};
+    std::vector<uint64_t> sizes(number_of_levels, 0);
+    std::vector<std::vector<uint64_t>> minimisers(number_of_levels);
+    if (replacement)
+    {
+        experiment_levels(minimiser_file, ibf_args, expressions, sizes);
+        minimiser_file_reader fin{minimiser_file};
+        fin.for_each([&] (uint64_t const minHash, uint16_t const minimiser_count)
+        {
+            int const j = expression_level(expressions, minimiser_count);
+            if (j >= 0)
+                minimisers[j].push_back(minHash);
+        });
+    }
+
+    // In a partitioned index the bin of the experiment is found in the IBFs of its partition.
+    std::vector<std::vector<size_t>> partitions{};
+    load_partitions(partitions, std::string{ibf_args.path_out} + "IBF_Partitions.partitions");
+    std::string suffix{};
+    size_t partition_bin{bin};
+    for (size_t p = 0; p < partitions.size(); p++)
+    {
+        auto it = std::ranges::find(partitions[p], bin);
+        if (it != partitions[p].end())
+        {
+            suffix = partition_suffix(p, partitions.size());
+            partition_bin = it - partitions[p].begin();
+        }
+    }
+    if (!partitions.empty() && suffix.empty())
+        throw std::invalid_argument{"Error. The index contains no experiment " + std::to_string(bin) + "."};
+
+    staged_index_files staged{};
+    std::vector<std::vector<double>> fprs(number_of_levels);
+    for (size_t j = 0; j < number_of_levels; j++)
+    {
+        seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed> ibf;
+        load_index_ibf(ibf, ibf_args, ibf_level_file(ibf_args, j, suffix));
+        if (partition_bin >= ibf.bin_count())
+        {
+            throw std::invalid_argument{"Error. The index contains only " + std::to_string(ibf.bin_count()) +
+                                        " experiments, there is no bin " + std::to_string(bin) + "."};
+        }
+        ibf.clear(seqan3::bin_index{partition_bin});
+        insert_sorted(ibf, minimisers[j], partition_bin);
+        store_index_ibf(ibf, ibf_args, staged.stage(ibf_level_file(ibf_args, j, suffix)));
+        fprs[j].push_back(bin_fpr(ibf, sizes[j]));
+    }
+
+    std::filesystem::path const fpr_file = std::string{ibf_args.path_out} + "IBF_FPRs.fprs";
+    update_level_file(fpr_file, bin, fprs, staged.stage(fpr_file));
+    if (ibf_args.samplewise && replacement)
+    {
+        std::vector<std::vector<uint16_t>> levels(number_of_levels);
+        for (size_t j = 0; j < number_of_levels; j++)
+            levels[j].push_back(expressions[j]);
+        std::filesystem::path const levels_file = std::string{ibf_args.path_out} + "IBF_Levels.levels";
+        update_level_file(levels_file, bin, levels, staged.stage(levels_file));
+    }
+
+    // A cleared bin keeps its name, so the experiments after it keep their positions.
+    std::filesystem::path const stored_files = std::string{ibf_args.path_out} + "Stored_Files.txt";
+    if (replacement && std::filesystem::exists(stored_files))
+    {
+        std::vector<std::string> names{};
+        std::string line{};
+        std::ifstream fin{stored_files};
+        while (std::getline(fin, line))
+            names.push_back(line);
+        fin.close();
+        if (bin < names.size())
+        {
+            std::stringstream name{};
+            name << minimiser_file;
+            names[bin] = name.str();
+        }
+        std::ofstream outfile{staged.stage(stored_files)};
+        for (auto && name : names)
+            outfile << name << "\n";
+    }
+
+    staged.commit();
+
+    return ibf_args.expression_thresholds;
+}
+
+// The members of an uncompressed seqan3::interleaved_bloom_filter in the order they are serialised. Reading an IBF file
+// into this layout gives access to its bits, the bit of hash position p in bin b is data[p * technical_bins + b].
+struct ibf_layout
+{
+    size_t bins{};
+    size_t technical_bins{};
+    size_t bin_size{};
+    size_t hash_shift{};
+    size_t bin_words{};
+    size_t hash_funs{};
+    sdsl::bit_vector data{};
+
+    template <typename archive_t>
+    void serialize(archive_t & archive)
+    {
+        archive(bins, technical_bins, bin_size, hash_shift, bin_words, hash_funs, data);
+    }
+
+    //!\brief Whether the members match the public properties of ibf and are consistent.
+    bool matches(seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed> const & ibf) const
+    {
+        return (bins == ibf.bin_count()) && (bin_size == ibf.bin_size()) && (hash_funs == ibf.hash_function_count()) &&
+               (technical_bins == bin_words * 64) && (data.size() == technical_bins * bin_size);
+    }
+};
+
+// Convert an uncompressed IBF to its layout and back by the serialisation of seqan3.
+template <typename source_t, typename target_t>
+void convert_serialised(source_t const & source, target_t & target)
+{
+    std::stringstream buffer{};
+    {
+        cereal::BinaryOutputArchive oarchive{buffer};
+        oarchive(source);
+    }
+    cereal::BinaryInputArchive iarchive{buffer};
+    iarchive(target);
+}
+
+// The layout has to match the private members of seqan3::interleaved_bloom_filter, which can change between versions of
+// seqan3. So a small IBF is converted to the layout and back, which has to give the same IBF.
+void check_ibf_layout()
+{
+    seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed> ibf{seqan3::bin_count{65u},
+                                                                           seqan3::bin_size{17u},
+                                                                           seqan3::hash_function_count{2u}};
+    for (size_t bin = 0; bin < 65; bin++)
+        ibf.emplace(bin * 7919u, seqan3::bin_index{bin});
+
+    ibf_layout layout{};
+    seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed> converted_ibf{};
+    try
+    {
+        convert_serialised(ibf, layout);
+        convert_serialised(layout, converted_ibf);
+    }
+    catch (std::exception const &)
+    {
+        layout = ibf_layout{};
+    }
+    if (!layout.matches(ibf) || !(converted_ibf == ibf))
+    {
+        throw std::runtime_error{"Error. The serialisation of the IBFs of this seqan3 version is not supported, the "
+                                 "indexes can not be merged."};
+    }
+}
+
+// Load the IBF of an index as layout. A compressed IBF is decompressed first.
+void load_ibf_layout(ibf_layout & layout, estimate_ibf_arguments const & ibf_args, std::filesystem::path const & filename)
+{
+    if (ibf_args.compressed)
+    {
+        seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed> ibf;
+        load_index_ibf(ibf, ibf_args, filename);
+        convert_serialised(ibf, layout);
+    }
+    else
+    {
+        load_ibf(layout, filename);
+    }
+}
+
+// Merge indexes of disjoint experiments
+std::vector<uint16_t> merge_indexes(std::vector<std::filesystem::path> const & indexes,
+                                    estimate_ibf_arguments & ibf_args)
+{
+    if (indexes.empty())
+        throw std::invalid_argument{"Error. Please provide at least one index to merge."};
+    check_ibf_layout();
+
+    // All indexes have to be built with the same arguments.
+    std::vector<estimate_ibf_arguments> index_args(indexes.size());
+    for (size_t s = 0; s < indexes.size(); s++)
+    {
+        index_args[s].path_out = indexes[s];
+        load_args(index_args[s], indexes[s].string() + "IBF_Data");
+        if (std::filesystem::exists(indexes[s].string() + "IBF_Partitions.partitions"))
+            throw std::invalid_argument{"Error. The index " + indexes[s].string() + " is partitioned and can not be merged."};
+        estimate_ibf_arguments const & first = index_args[0];
+        if ((index_args[s].k != first.k) || (index_args[s].w_size.get() != first.w_size.get()) ||
+            (index_args[s].s.get() != first.s.get()) || (index_args[s].shape.to_ulong() != first.shape.to_ulong()) ||
+            (index_args[s].number_expression_thresholds != first.number_expression_thresholds) ||
+            (index_args[s].samplewise != first.samplewise) ||
+            (index_args[s].expression_thresholds != first.expression_thresholds))
+        {
+            throw std::invalid_argument{"Error. The index " + indexes[s].string() + " was built with other arguments than "
+                                        "the index " + indexes[0].string() + "."};
+        }
+    }
+
+    std::filesystem::path const path_out = ibf_args.path_out;
+    bool const compressed = ibf_args.compressed;
+    uint8_t const threads = ibf_args.threads;
+    ibf_args = index_args[0];
+    ibf_args.path_out = path_out;
+    ibf_args.compressed = compressed;
+    ibf_args.threads = threads;
+    size_t const number_of_levels = ibf_args.number_expression_thresholds;
+
+    // The level files are concatenated per level, their first line gives the number of experiments of every index.
+    std::vector<std::vector<std::string>> fprs{};
+    std::vector<std::vector<std::string>> levels{};
+    std::vector<size_t> index_bins(indexes.size());
+    for (size_t s = 0; s < indexes.size(); s++)
+    {
+        std::vector<std::vector<std::string>> index_fprs = read_level_file(indexes[s].string() + "IBF_FPRs.fprs");
+        std::vector<std::vector<std::string>> index_levels{};
+        if (ibf_args.samplewise)
+            index_levels = read_level_file(indexes[s].string() + "IBF_Levels.levels");
+        if ((index_fprs.size() != number_of_levels) || (ibf_args.samplewise && (index_levels.size() != number_of_levels)))
+            throw std::invalid_argument{"Error. The files of the index " + indexes[s].string() + " do not contain all levels."};
+
+        index_bins[s] = index_fprs[0].size();
+        fprs.resize(number_of_levels);
+        levels.resize(ibf_args.samplewise ? number_of_levels : 0);
+        for (size_t j = 0; j < number_of_levels; j++)
+        {
+            fprs[j].insert(fprs[j].end(), index_fprs[j].begin(), index_fprs[j].end());
+            if (ibf_args.samplewise)
+                levels[j].insert(levels[j].end(), index_levels[j].begin(), index_levels[j].end());
+        }
+    }
+    size_t const number_of_bins = std::accumulate(index_bins.begin(), index_bins.end(), size_t{0});
+
+    // The output can be one of the merged indexes, so its files are only replaced after all are written.
+    staged_index_files staged{};
+
+    for (size_t j = 0; j < number_of_levels; j++)
+    {
+        ibf_layout merged{};
+        size_t first_bin{0};
+        for (size_t s = 0; s < indexes.size(); s++)
+        {
+            ibf_layout index_ibf{};
+            load_ibf_layout(index_ibf, index_args[s], ibf_level_file(index_args[s], j));
+            // Make sure the serialised IBF has the expected layout.
+            if ((index_ibf.bins != index_bins[s]) || (index_ibf.technical_bins != index_ibf.bin_words * 64) ||
+                (index_ibf.data.size() < index_ibf.technical_bins * index_ibf.bin_size))
+            {
+                throw std::runtime_error{"Error. The IBF " + ibf_level_file(index_args[s], j).string() + " can not be read "
+                                         "or does not match the experiments of its index."};
+            }
+
+            if (s == 0)
+            {
+                merged.bins = number_of_bins;
+                merged.bin_words = (number_of_bins + 63) / 64;
+                merged.technical_bins = merged.bin_words * 64;
+                merged.bin_size = index_ibf.bin_size;
+                merged.hash_shift = index_ibf.hash_shift;
+                merged.hash_funs = index_ibf.hash_funs;
+                merged.data = sdsl::bit_vector(merged.technical_bins * merged.bin_size, 0);
+            }
+            else if ((index_ibf.bin_size != merged.bin_size) || (index_ibf.hash_funs != merged.hash_funs))
+            {
+                throw std::invalid_argument{"Error. The IBFs of level " + std::to_string(j) + " of the indexes " +
+                                            indexes[0].string() + " and " + indexes[s].string() + " have different bin "
+                                            "sizes or numbers of hash functions. Please build all indexes with the "
+                                            "same bin sizes, e.g. by --bin-size. The bin size of the first index is " +
+                                            std::to_string(merged.bin_size) + "."};
+            }
+
+            // Every position is copied 64 bins at a time. The rows of the merged IBF start at a new word, so every thread
+            // writes its own words.
+            #pragma omp parallel for schedule(static) num_threads(threads)
+            for (size_t pos = 0; pos < merged.bin_size; pos++)
+            {
+                for (size_t bin = 0; bin < index_ibf.bins; bin += 64)
+                {
+                    uint8_t const length = std::min<size_t>(64, index_ibf.bins - bin);
+                    merged.data.set_int(pos * merged.technical_bins + first_bin + bin,
+                                        index_ibf.data.get_int(pos * index_ibf.technical_bins + bin, length), length);
+                }
+            }
+            first_bin += index_ibf.bins;
+        }
+
+        std::filesystem::path const filename = staged.stage(ibf_level_file(ibf_args, j));
+        {
+            std::ofstream os{filename, std::ios::binary};
+            cereal::BinaryOutputArchive oarchive{os};
+            oarchive(merged);
+        }
+        if (compressed)
+        {
+            seqan3::interleaved_bloom_filter<seqan3::data_layout::uncompressed> ibf;
+            load_ibf(ibf, filename);
+            store_ibf(seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed>{ibf}, filename);
+        }
+    }
+
+    write_level_file(staged.stage(path_out.string() + "IBF_FPRs.fprs"), fprs);
+    if (ibf_args.samplewise)
+        write_level_file(staged.stage(path_out.string() + "IBF_Levels.levels"), levels);
+
+    // Experiment names are only merged, if all indexes contain them.
+    bool const experiment_names = std::ranges::all_of(indexes, [] (std::filesystem::path const & index)
+    {
+        return std::filesystem::exists(index.string() + "Stored_Files.txt");
+    });
+    if (experiment_names)
+    {
+        std::vector<std::string> names{};
+        for (auto && index : indexes)
+        {
+            std::ifstream fin{index.string() + "Stored_Files.txt"};
+            std::string line{};
+            while (std::getline(fin, line))
+                names.push_back(line);
+        }
+        std::ofstream outfile{staged.stage(path_out.string() + "Stored_Files.txt")};
+        for (auto && name : names)
+            outfile << name << "\n";
+    }
+
+    store_args(ibf_args, staged.stage(path_out.string() + "IBF_Data"));
+    staged.commit();
+    std::filesystem::remove(path_out.string() + "IBF_Partitions.partitions");
+
+    return ibf_args.expression_thresholds;
+}
+
 // Actuall minimiser calculation
 void calculate_minimiser(std::vector<std::filesystem::path> const & sequence_files,
-                         robin_hood::unordered_set<uint64_t> const & include_set_table,
-                         robin_hood::unordered_set<uint64_t> const & exclude_set_table,
+                         minimiser_set const & include_set_table,
+                         minimiser_set const & exclude_set_table,
                          min_arguments const & args,
                          minimiser_arguments const & minimiser_args,
                          unsigned const i,
-                         std::vector<uint8_t> & cutoffs)
+                         std::vector<uint8_t> & cutoffs,
+                         uint8_t const sample_threads = 1,
+                         size_t const sample_memory = 0)
 {
-    robin_hood::unordered_node_map<uint64_t, uint16_t> hash_table{}; // Storage for minimisers
+    flat_counter_table<uint16_t> hash_table{}; // Storage for minimisers
     uint16_t count{0};
     uint8_t cutoff{0};
-
-    // Create a smaller cutoff table to save RAM, this cutoff table is only used for constructing the hash table
-    // and afterwards discarded.
-    robin_hood::unordered_node_map<uint64_t, uint8_t>  cutoff_table;
-    std::ofstream outfile;
     unsigned file_iterator = std::accumulate(minimiser_args.samples.begin(), minimiser_args.samples.begin() + i, 0);
 
     bool const calculate_cutoffs = cutoffs.empty();
@@ -758,35 +2430,30 @@ void calculate_minimiser(std::vector<std::filesystem::path> const & sequence_fil
         cutoff = cutoffs[i];
 
     // Fill hash_table with minimisers.
-    for (unsigned f = 0; f < minimiser_args.samples[i]; f++)
-    {
-        seqan3::sequence_file_input<my_traits, seqan3::fields<seqan3::field::seq>> fin{sequence_files[file_iterator+f]};
-        fill_hash_table(args, fin, hash_table, cutoff_table, include_set_table, exclude_set_table, (minimiser_args.include_file != ""), cutoff);
-    }
-    cutoff_table.clear();
+    if (minimiser_args.max_memory == 0)
+        fill_hash_table_sample(args, minimiser_args, sequence_files, file_iterator, minimiser_args.samples[i], hash_table,
+                               include_set_table, exclude_set_table, cutoff, sample_threads);
 
-    // Write minimiser and their counts to binary
-    outfile.open(std::string{args.path_out} + std::string{sequence_files[file_iterator].stem()}
-                 + ".minimiser", std::ios::binary);
-    auto hash_size = hash_table.size();
-    outfile.write(reinterpret_cast<const char*>(&hash_size), sizeof(hash_size));
-    outfile.write(reinterpret_cast<const char*>(&cutoff), sizeof(cutoff));
-    outfile.write(reinterpret_cast<const char*>(&args.k), sizeof(args.k));
-    outfile.write(reinterpret_cast<const char*>(&args.w_size.get()), sizeof(args.w_size.get()));
-    outfile.write(reinterpret_cast<const char*>(&args.s.get()), sizeof(args.s.get()));
-    bool ungapped = args.shape.all();
-    outfile.write(reinterpret_cast<const char*>(&ungapped), sizeof(ungapped));
+    // Write minimiser and their counts to binary, the minimisers are written in increasing order.
+    minimiser_file_writer outfile{std::string{args.path_out} + std::string{sequence_files[file_iterator].stem()}
+                                  + ".minimiser", minimiser_file_header{args, cutoff}};
 
-    if (!ungapped)
+    if (minimiser_args.max_memory > 0)
     {
-        uint64_t shapesize = args.shape.to_ulong();
-        outfile.write(reinterpret_cast<const char*>(&shapesize), sizeof(shapesize));
+        count_sample_external(args, minimiser_args, sequence_files, file_iterator, minimiser_args.samples[i],
+                              include_set_table, exclude_set_table, cutoff, sample_memory,
+                              [&] (uint64_t const minHash, uint16_t const minimiser_count)
+        {
+            outfile.push(minHash, minimiser_count);
+        });
     }
-
-    for (auto && hash : hash_table)
+    else
     {
-        outfile.write(reinterpret_cast<const char*>(&hash.first), sizeof(hash.first));
-        outfile.write(reinterpret_cast<const char*>(&hash.second), sizeof(hash.second));
+        // The minimisers are sorted within the hash table, so sorting needs no additional memory.
+        hash_table.extract_sorted([&] (uint64_t const minHash, uint16_t const minimiser_count)
+        {
+            outfile.push(minHash, minimiser_count);
+        });
     }
     outfile.close();
 }
@@ -795,8 +2462,8 @@ void minimiser(std::vector<std::filesystem::path> const & sequence_files, min_ar
                minimiser_arguments & minimiser_args, std::vector<uint8_t> & cutoffs)
 {
     // Declarations
-    robin_hood::unordered_set<uint64_t> include_set_table{}; // Storage for minimisers in include file
-    robin_hood::unordered_set<uint64_t> exclude_set_table{}; // Storage for minimisers in exclude file
+    minimiser_set include_set_table{}; // Storage for minimisers in include file
+    minimiser_set exclude_set_table{}; // Storage for minimisers in exclude file
 
     check_cutoffs_samples(sequence_files, minimiser_args.paired, minimiser_args.samples, cutoffs);
 
@@ -810,10 +2477,134 @@ void minimiser(std::vector<std::filesystem::path> const & sequence_files, min_ar
 
     size_t const chunk_size = std::clamp<size_t>(std::bit_ceil(minimiser_args.samples.size() / args.threads), 1u, 64u);
 
+    // If there are fewer samples than threads, the samples are processed one after another and the reads of one sample
+    // are distributed over all threads instead.
+    uint8_t const sample_threads = (minimiser_args.samples.size() < args.threads) ? args.threads : 1;
+
+    // With --max-memory the memory is shared by all samples, which are processed at the same time.
+    size_t const sample_memory = minimiser_args.max_memory * 1024 * 1024 /
+                                 ((sample_threads == 1) ? std::min<size_t>(args.threads, minimiser_args.samples.size()) : 1);
+
     // Add minimisers to ibf
-    #pragma omp parallel for schedule(dynamic, chunk_size)
+    #pragma omp parallel for schedule(dynamic, chunk_size) if(sample_threads == 1)
     for(unsigned i = 0; i < minimiser_args.samples.size(); i++)
     {
-        calculate_minimiser(sequence_files, include_set_table, exclude_set_table, args, minimiser_args, i, cutoffs);
+        calculate_minimiser(sequence_files, include_set_table, exclude_set_table, args, minimiser_args, i, cutoffs,
+                            sample_threads, sample_memory);
+    }
+}
+
+// The minimisers of one file for minimiser_merge in increasing order.
+struct minimiser_merge_cursor
+{
+    minimiser_file_reader reader;
+    std::vector<uint64_t> minimisers{};
+    std::vector<uint16_t> counts{};
+    size_t position{0};
+
+    explicit minimiser_merge_cursor(std::filesystem::path const & filename) : reader{filename}
+    {
+        if (reader.header().version > 1)
+            return;
+
+        // Version 1 files are not sorted, so all their minimisers are read and sorted.
+        std::vector<std::pair<uint64_t, uint16_t>> records{};
+        reader.for_each([&] (uint64_t const minimiser, uint16_t const minimiser_count)
+        {
+            records.emplace_back(minimiser, minimiser_count);
+        });
+        std::sort(records.begin(), records.end());
+        for (auto && [minimiser, minimiser_count] : records)
+        {
+            minimisers.push_back(minimiser);
+            counts.push_back(minimiser_count);
+        }
+    }
+
+    // Go to the next minimiser, returns false if there is none.
+    bool next()
+    {
+        if (++position < minimisers.size())
+            return true;
+        position = 0;
+        return (reader.header().version > 1) && reader.read_block(minimisers, counts);
+    }
+
+    // Go to the first minimiser, returns false if there is none.
+    bool first()
+    {
+        if (reader.header().version > 1)
+            return reader.read_block(minimisers, counts);
+        return !minimisers.empty();
+    }
+};
+
+void minimiser_merge(std::vector<std::filesystem::path> const & minimiser_files, std::filesystem::path const & output_file,
+                     uint8_t const cutoff)
+{
+    if (minimiser_files.empty())
+        throw std::invalid_argument{"Error. Please give at least one minimiser file to merge."};
+
+    std::vector<minimiser_merge_cursor> cursors{};
+    cursors.reserve(minimiser_files.size());
+    for (auto && file : minimiser_files)
+        cursors.emplace_back(file);
+
+    minimiser_file_header header = cursors[0].reader.header();
+    for (size_t f = 1; f < cursors.size(); ++f)
+    {
+        minimiser_file_header const & other = cursors[f].reader.header();
+        if ((other.k != header.k) || (other.window != header.window) || (other.seed != header.seed) ||
+            (other.ungapped != header.ungapped) || (!header.ungapped && (other.shape != header.shape)))
+        {
+            throw std::invalid_argument{"Error. The minimiser files " + minimiser_files[0].string() + " and " +
+                                        minimiser_files[f].string() + " were created with different minimiser "
+                                        "arguments and can not be merged."};
+        }
+        header.cutoff = std::min(header.cutoff, other.cutoff);
+    }
+    // Every merged minimiser occurs more often than the smallest cutoff of the files.
+    header.cutoff = std::max(header.cutoff, cutoff);
+
+    // The files are sorted, so the minimisers are merged by always taking the smallest current minimiser of all files.
+    using entry_t = std::pair<uint64_t, size_t>;
+    std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue{};
+    for (size_t f = 0; f < cursors.size(); ++f)
+    {
+        if (cursors[f].first())
+            queue.emplace(cursors[f].minimisers[0], f);
+    }
+
+    // The merged minimisers are written to a temporary file, which replaces the output file at the end. So the output
+    // file can be one of the merged files, which stay mapped until then.
+    std::filesystem::path const tmp_file = output_file.string() + ".tmp";
+    try
+    {
+        minimiser_file_writer outfile{tmp_file, header};
+        while (!queue.empty())
+        {
+            uint64_t const minHash = queue.top().first;
+            uint32_t minimiser_count{0};
+            while (!queue.empty() && (queue.top().first == minHash))
+            {
+                size_t const f = queue.top().second;
+                queue.pop();
+                minimiser_count += cursors[f].counts[cursors[f].position];
+                if (cursors[f].next())
+                    queue.emplace(cursors[f].minimisers[cursors[f].position], f);
+            }
+
+            minimiser_count = std::min<uint32_t>(65534u, minimiser_count);
+            if (minimiser_count > cutoff)
+                outfile.push(minHash, minimiser_count);
+        }
+        outfile.close();
+    }
+    catch (...)
+    {
+        std::error_code ec{};
+        std::filesystem::remove(tmp_file, ec);
+        throw;
     }
+    std::filesystem::rename(tmp_file, output_file);
 }
@@ -41,6 +41,13 @@ void initialise_arguments_ibf(seqan3::argument_parser & parser, estimate_ibf_arg
                                                               "the expression thresholds are determined automatically.");
     parser.add_option(num_hash, 'n', "hash", "Number of hash functions that should be used when constructing "
                                              "one IBF.");
+    parser.add_option(ibf_args.partitions, '\0', "partitions", "Number of IBFs per expression level. The experiments are "
+                                                            "grouped by their size, so every IBF has bins of a fitting "
+                                                            "size. Default: 1.");
+    parser.add_option(ibf_args.bin_sizes, '\0', "bin-size", "List of bin sizes per expression level, which are used "
+                                                          "instead of the bin sizes determined by the false positive "
+                                                          "rates. Indexes of different experiments can only be merged, "
+                                                          "if they are built with the same bin sizes. Default: None.");
 }
 
 void parsing(seqan3::argument_parser & parser, min_arguments & args)
@@ -72,6 +79,15 @@ void initialise_arguments_minimiser(seqan3::argument_parser & parser, minimiser_
                                                               "and therefore be ignored. Default: Every sample has an"
                                                               "automatically genereated cutoff, which is based on the "
                                                               "file size.");
+    parser.add_option(minimiser_args.sketch_memory, '\0', "sketch-memory", "Memory in MiB per sample for a count-min "
+                                                              "sketch, which replaces the exact counting of minimisers "
+                                                              "below the cutoff. Counts of minimisers passing the cutoff "
+                                                              "might be slightly overestimated. Default: 0, exact "
+                                                              "counting.");
+    parser.add_option(minimiser_args.max_memory, '\0', "max-memory", "Memory in MiB for counting minimisers. If set, "
+                                                              "minimisers are partitioned into temporary files in the "
+                                                              "output directory, which are counted one after another. "
+                                                              "Default: 0, all minimisers are counted in memory.");
 
 }
 
@@ -185,6 +201,17 @@ int run_needle_ibf(seqan3::argument_parser & parser)
     parser.add_option(expression_by_genome_file, '\0', "levels-by-genome", "Sequence file containing minimizers, only "
                                                                             "those minimizers will be considered for "
                                                                             "determining the expression thresholds.");
+    parser.add_option(minimiser_args.size_sketch_memory, '\0', "size-sketch-memory", "Memory in MiB per sample for "
+                                                              "sketches, which estimate the number of minimisers in an "
+                                                              "additional pass over the sequence files. The IBFs are "
+                                                              "sized by these estimates. Default: 0, the IBFs are sized "
+                                                              "by the file sizes.");
+    parser.add_option(minimiser_args.checkpoint_interval, '\0', "checkpoint", "Number of experiments, after which the "
+                                                                         "partially built IBFs and the finished "
+                                                                         "experiments are stored, so the build can be "
+                                                                         "resumed. Default: 0, no checkpoints.");
+    parser.add_flag(minimiser_args.resume, '\0', "resume", "If set, the build continues from the last checkpoint in the "
+                                                          "output directory and skips the finished experiments.");
 
     try
     {
@@ -207,7 +234,7 @@ int run_needle_ibf(seqan3::argument_parser & parser)
     {
         ibf(sequence_files, ibf_args, minimiser_args, fpr, cutoffs, expression_by_genome_file, num_hash);
     }
-    catch (const std::invalid_argument & e)
+    catch (const std::exception & e)
     {
         std::cerr << e.what() << std::endl;
         return -1;
@@ -224,6 +251,7 @@ int run_needle_ibf_min(seqan3::argument_parser & parser)
     std::filesystem::path expression_by_genome_file = "";
     std::vector<double> fpr{}; // The fpr of one IBF, can be different for different expression levels
     std::filesystem::path input_file{};
+    uint8_t levels_in_memory{0};
 
     parser.info.short_description = "Constructs the Needle index from the minimiser files created by needle minimiser.";
 
@@ -235,6 +263,10 @@ int run_needle_ibf_min(seqan3::argument_parser & parser)
     parser.add_option(expression_by_genome_file, '\0', "levels-by-genome", "Sequence file containing minimizers, only "
                                                                             "those minimizers will be considered for "
                                                                             "determining the expression thresholds.");
+    parser.add_option(levels_in_memory, '\0', "levels-in-memory", "Number of IBFs, which are kept in memory at the "
+                                                                  "same time. The minimiser files are read again for "
+                                                                  "every group of IBFs. Default: 0, all IBFs are built "
+                                                                  "at once.");
 
     initialise_arguments_ibf(parser, ibf_args, num_hash, fpr);
 
@@ -256,9 +288,43 @@ int run_needle_ibf_min(seqan3::argument_parser & parser)
 
     try
     {
-        ibf(minimiser_files, ibf_args, fpr, expression_by_genome_file, num_hash);
+        ibf(minimiser_files, ibf_args, fpr, expression_by_genome_file, num_hash, levels_in_memory);
     }
-    catch (const std::invalid_argument & e)
+    catch (const std::exception & e)
+    {
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
+int run_needle_merge(seqan3::argument_parser & parser)
+{
+    estimate_ibf_arguments ibf_args{};
+    std::vector<std::filesystem::path> indexes{};
+
+    parser.info.short_description = "Merges Needle indexes of different experiments into one index.";
+    parser.add_positional_option(indexes, "Please provide the directories of at least one Needle index.");
+    parser.add_option(ibf_args.path_out, 'o', "out", "Directory, where output files should be saved.");
+    parser.add_option(ibf_args.threads, 't', "threads", "Number of threads to use. Default: 1.");
+    parser.add_flag(ibf_args.compressed, 'c', "compressed", "If c is set, the merged IBFS are compressed. Default: Not "
+                                                            "compressed.");
+
+    try
+    {
+        parser.parse();
+    }
+    catch (seqan3::argument_parser_error const & ext)
+    {
+        seqan3::debug_stream << "Error. Incorrect command line input for merge. " << ext.what() << "\n";
+        return -1;
+    }
+    try
+    {
+        merge_indexes(indexes, ibf_args);
+    }
+    catch (const std::exception & e)
     {
         std::cerr << e.what() << std::endl;
         return -1;
@@ -300,7 +366,128 @@ int run_needle_minimiser(seqan3::argument_parser & parser)
     {
         minimiser(sequence_files, args, minimiser_args, cutoffs);
     }
-    catch (const std::invalid_argument & e)
+    catch (const std::exception & e)
+    {
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
+int run_needle_minimiser_merge(seqan3::argument_parser & parser)
+{
+    std::vector<std::filesystem::path> minimiser_files{};
+    std::filesystem::path output_file{"merged.minimiser"};
+    uint8_t cutoff{0};
+    std::filesystem::path input_file{};
+
+    parser.info.short_description = "Merges minimiser files of the same experiment into one minimiser file.";
+    parser.add_positional_option(minimiser_files, "Please provide at least one minimiser file OR provide one file "
+                                                  "containing all minimiser files with the extension '.lst'.");
+    parser.add_option(output_file, 'o', "out", "Name of the output file. Default: merged.minimiser.");
+    parser.add_option(cutoff, '\0', "cutoff", "Only minimisers occurring more often than the cutoff in all files "
+                                             "together are stored. Default: 0.");
+
+    try
+    {
+        parser.parse();
+        if (minimiser_files[0].extension() == ".lst")
+        {
+            input_file = minimiser_files[0];
+            minimiser_files = {};
+            read_input_file_list(minimiser_files, input_file);
+        }
+    }
+    catch (seqan3::argument_parser_error const & ext)
+    {
+        seqan3::debug_stream << "Error. Incorrect command line input for minimiser-merge. " << ext.what() << "\n";
+        return -1;
+    }
+    try
+    {
+        minimiser_merge(minimiser_files, output_file, cutoff);
+    }
+    catch (const std::exception & e)
+    {
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
+int run_needle_append(seqan3::argument_parser & parser)
+{
+    estimate_ibf_arguments ibf_args{};
+    std::vector<std::filesystem::path> minimiser_files{};
+    std::filesystem::path input_file{};
+
+    parser.info.short_description = "Adds experiments to a Needle index, only the minimisers of the new experiments "
+                                    "are inserted.";
+    parser.add_positional_option(minimiser_files, "Please provide at least one minimiser file OR provide one file "
+                                                  "containing all minimiser files with the extension '.lst'.");
+    parser.add_option(ibf_args.path_out, 'i', "in", "Directory where the Needle index can be found. The index is "
+                                                    "changed in place.");
+    parser.add_option(ibf_args.threads, 't', "threads", "Number of threads to use. Default: 1.");
+
+    try
+    {
+        parser.parse();
+        if (minimiser_files[0].extension() == ".lst")
+        {
+            input_file = minimiser_files[0];
+            minimiser_files = {};
+            read_input_file_list(minimiser_files, input_file);
+        }
+    }
+    catch (seqan3::argument_parser_error const & ext)
+    {
+        seqan3::debug_stream << "Error. Incorrect command line input for append. " << ext.what() << "\n";
+        return -1;
+    }
+    try
+    {
+        append(minimiser_files, ibf_args);
+    }
+    catch (const std::exception & e)
+    {
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
+int run_needle_replace(seqan3::argument_parser & parser)
+{
+    estimate_ibf_arguments ibf_args{};
+    size_t bin{};
+    std::filesystem::path minimiser_file{};
+
+    parser.info.short_description = "Clears the bin of one experiment in a Needle index and optionally inserts the "
+                                    "minimisers of a replacing experiment.";
+    parser.add_option(bin, 'b', "bin", "Position of the experiment in the index, starting with 0.",
+                      seqan3::option_spec::required);
+    parser.add_option(ibf_args.path_out, 'i', "in", "Directory where the Needle index can be found. The index is "
+                                                    "changed in place.");
+    parser.add_option(minimiser_file, 'm', "minimiser", "Minimiser file of the replacing experiment. Default: None, "
+                                                        "the bin is only cleared.");
+
+    try
+    {
+        parser.parse();
+    }
+    catch (seqan3::argument_parser_error const & ext)
+    {
+        seqan3::debug_stream << "Error. Incorrect command line input for replace. " << ext.what() << "\n";
+        return -1;
+    }
+    try
+    {
+        replace(bin, minimiser_file, ibf_args);
+    }
+    catch (const std::exception & e)
     {
         std::cerr << e.what() << std::endl;
         return -1;
@@ -312,7 +499,7 @@ int run_needle_minimiser(seqan3::argument_parser & parser)
 int main(int argc, char const ** argv)
 {
     seqan3::argument_parser needle_parser{"needle", argc, argv, seqan3::update_notifications::on,
-    {"count", "estimate", "ibf", "ibfmin", "minimiser"}};
+    {"append", "count", "estimate", "ibf", "ibfmin", "merge", "minimiser", "minimiser-merge", "replace"}};
     needle_parser.info.description.push_back("Needle allows you to build an Interleaved Bloom Filter (IBF) with the "
                                              "command ibf or estimate the expression of transcripts with the command "
                                              "estimate.");
@@ -329,7 +516,9 @@ int main(int argc, char const ** argv)
         return -1;
     }
     seqan3::argument_parser & sub_parser = needle_parser.get_sub_parser(); // hold a reference to the sub_parser
-    if (sub_parser.info.app_name == std::string_view{"needle-count"})
+    if (sub_parser.info.app_name == std::string_view{"needle-append"})
+        run_needle_append(sub_parser);
+    else if (sub_parser.info.app_name == std::string_view{"needle-count"})
         run_needle_count(sub_parser);
     else if (sub_parser.info.app_name == std::string_view{"needle-estimate"})
         run_needle_estimate(sub_parser);
@@ -337,6 +526,12 @@ int main(int argc, char const ** argv)
         run_needle_ibf(sub_parser);
     else if (sub_parser.info.app_name == std::string_view{"needle-ibfmin"})
         run_needle_ibf_min(sub_parser);
+    else if (sub_parser.info.app_name == std::string_view{"needle-merge"})
+        run_needle_merge(sub_parser);
     else if (sub_parser.info.app_name == std::string_view{"needle-minimiser"})
         run_needle_minimiser(sub_parser);
+    else if (sub_parser.info.app_name == std::string_view{"needle-minimiser-merge"})
+        run_needle_minimiser_merge(sub_parser);
+    else if (sub_parser.info.app_name == std::string_view{"needle-replace"})
+        run_needle_replace(sub_parser);
 }
@@ -0,0 +1,359 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/needle/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstring>
+
+#include "minimiser_file.h"
+
+// Version 1 records are read in blocks of this many records.
+static constexpr size_t v1_records_per_block{4096};
+static constexpr size_t v1_record_size{sizeof(uint64_t) + sizeof(uint16_t)};
+
+// The header of a block of a version 2 file.
+struct minimiser_block_header
+{
+    uint32_t number_of_minimisers;
+    uint32_t size;
+    uint64_t first_minimiser;
+};
+static_assert(sizeof(minimiser_block_header) == 16);
+
+inline void write_varint(std::vector<uint8_t> & data, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        data.push_back(static_cast<uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+    data.push_back(static_cast<uint8_t>(value));
+}
+
+inline uint64_t read_varint(uint8_t const * & pos, uint8_t const * const end)
+{
+    uint64_t value{0};
+    for (int shift = 0; (pos != end) && (shift < 64); shift += 7)
+    {
+        uint8_t const byte = *pos++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (byte < 0x80)
+            return value;
+    }
+    throw std::runtime_error{"Corrupted block in minimiser file."};
+}
+
+minimiser_file_writer::minimiser_file_writer(std::filesystem::path const & filename_,
+                                             minimiser_file_header const & header) :
+    filename{filename_},
+    outfile{filename_, std::ios::binary}
+{
+    if (!outfile)
+        throw std::runtime_error{"Could not open file " + filename.string() + " for writing."};
+
+    std::memcpy(file_header.magic, minimiser_file_magic, sizeof(file_header.magic));
+    file_header.version = 2;
+    file_header.flags = minimiser_file_flags::incomplete;
+    file_header.blocks_offset = sizeof(file_header);
+    file_header.seed = header.seed;
+    file_header.shape = header.shape;
+    file_header.window = header.window;
+    file_header.k = header.k;
+    file_header.cutoff = header.cutoff;
+    file_header.ungapped = header.ungapped;
+    file_header.reserved = 0;
+
+    // The header is written again by close(), when the number of minimisers is known and the file is complete.
+    buffer.reserve(buffer_size);
+    append(&file_header, sizeof(file_header));
+    minimisers.reserve(records_per_block);
+    counts.reserve(records_per_block);
+    flusher = std::thread{[this] () { write_flushed_buffers(); }};
+}
+
+minimiser_file_writer::~minimiser_file_writer()
+{
+    if (outfile.is_open() && (std::uncaught_exceptions() == uncaught_exceptions))
+    {
+        try
+        {
+            close();
+        }
+        catch (...)
+        {}
+    }
+    stop_flusher();
+}
+
+void minimiser_file_writer::append(void const * bytes, size_t const size)
+{
+    char const * const begin = static_cast<char const *>(bytes);
+    buffer.insert(buffer.end(), begin, begin + size);
+    if (buffer.size() >= buffer_size)
+        flush();
+}
+
+// Runs in flusher and writes every buffer handed over by flush(), until stop_flusher() is called.
+void minimiser_file_writer::write_flushed_buffers()
+{
+    std::unique_lock lock{flush_mutex};
+    while (true)
+    {
+        flush_condition.wait(lock, [this] () { return flush_pending || stop_flushing; });
+        if (!flush_pending)
+            return;
+        lock.unlock();
+        outfile.write(flush_buffer.data(), flush_buffer.size());
+        lock.lock();
+        flush_pending = false;
+        flush_condition.notify_all();
+    }
+}
+
+void minimiser_file_writer::stop_flusher()
+{
+    if (!flusher.joinable())
+        return;
+    {
+        std::lock_guard lock{flush_mutex};
+        stop_flushing = true;
+    }
+    flush_condition.notify_all();
+    flusher.join();
+}
+
+// Hand the buffer over to the flusher, after the previous buffer was written.
+void minimiser_file_writer::flush()
+{
+    wait_for_flush();
+    std::swap(buffer, flush_buffer);
+    buffer.clear();
+    {
+        std::lock_guard lock{flush_mutex};
+        flush_pending = true;
+    }
+    flush_condition.notify_all();
+}
+
+void minimiser_file_writer::wait_for_flush()
+{
+    std::unique_lock lock{flush_mutex};
+    flush_condition.wait(lock, [this] () { return !flush_pending; });
+    if (!outfile)
+        throw std::runtime_error{"Could not write file " + filename.string() + "."};
+}
+
+void minimiser_file_writer::write_block()
+{
+    if (minimisers.empty())
+        return;
+
+    data.clear();
+    for (size_t i = 1; i < minimisers.size(); ++i)
+        write_varint(data, minimisers[i] - minimisers[i - 1]);
+    for (uint16_t const count : counts)
+        write_varint(data, count);
+
+    minimiser_block_header const block{static_cast<uint32_t>(minimisers.size()), static_cast<uint32_t>(data.size()),
+                                       minimisers[0]};
+    append(&block, sizeof(block));
+    append(data.data(), data.size());
+    directory.push_back({offset, block.first_minimiser, block.number_of_minimisers, 0});
+    offset += sizeof(block) + data.size();
+    minimisers.clear();
+    counts.clear();
+}
+
+void minimiser_file_writer::close()
+{
+    write_block();
+
+    // Only counts occurring are stored.
+    uint64_t number_of_counts{0};
+    for (uint64_t c = 0; c < histogram.size(); ++c)
+    {
+        if (histogram[c] > 0)
+        {
+            append(&c, sizeof(c));
+            append(&histogram[c], sizeof(histogram[c]));
+            ++number_of_counts;
+        }
+    }
+    append(&number_of_counts, sizeof(number_of_counts));
+
+    append(directory.data(), directory.size() * sizeof(minimiser_block_entry));
+    flush();
+    wait_for_flush();
+    stop_flusher();
+
+    file_header.flags = minimiser_file_flags::count_histogram | minimiser_file_flags::block_directory;
+    file_header.number_of_minimisers = number_of_minimisers;
+    file_header.number_of_blocks = directory.size();
+    outfile.seekp(0);
+    outfile.write(reinterpret_cast<const char*>(&file_header), sizeof(file_header));
+    outfile.close();
+    if (!outfile)
+        throw std::runtime_error{"Could not write file " + filename.string() + "."};
+}
+
+minimiser_file_reader::minimiser_file_reader(std::filesystem::path const & filename_) :
+    filename{filename_},
+    file{filename_}
+{
+    if (!file.is_open())
+        throw std::runtime_error{"Could not open file " + filename.string() + "."};
+    if ((file.size() >= sizeof(minimiser_file_v2_header)) &&
+        (std::memcmp(file.data(), minimiser_file_magic, sizeof(minimiser_file_magic)) == 0))
+    {
+        minimiser_file_v2_header file_header{};
+        std::memcpy(&file_header, file.data(), sizeof(file_header));
+        if (file_header.version != 2)
+            throw std::runtime_error{"The minimiser file " + filename.string() + " has the unsupported version " +
+                                     std::to_string(file_header.version) + "."};
+        if (file_header.flags & minimiser_file_flags::incomplete)
+            throw std::runtime_error{"The minimiser file " + filename.string() + " is incomplete, writing it was "
+                                     "interrupted."};
+
+        header_.version = file_header.version;
+        header_.flags = file_header.flags;
+        header_.number_of_minimisers = file_header.number_of_minimisers;
+        header_.cutoff = file_header.cutoff;
+        header_.k = file_header.k;
+        header_.window = file_header.window;
+        header_.seed = file_header.seed;
+        header_.ungapped = file_header.ungapped;
+        header_.shape = file_header.shape;
+        read_directory(file_header);
+    }
+    else
+    {
+        // Version 1 files start with the number of minimisers.
+        size_t const header_size = 2 * sizeof(uint64_t) + 2 * sizeof(uint8_t) + sizeof(uint32_t) + sizeof(bool);
+        if (file.size() < header_size)
+            throw std::runtime_error{"File " + filename.string() + " is not a minimiser file."};
+
+        char const * pos = file.data();
+        auto read = [&pos] (auto & value)
+        {
+            std::memcpy(&value, pos, sizeof(value));
+            pos += sizeof(value);
+        };
+        header_.version = 1;
+        read(header_.number_of_minimisers);
+        read(header_.cutoff);
+        read(header_.k);
+        read(header_.window);
+        read(header_.seed);
+        read(header_.ungapped);
+        if (!header_.ungapped)
+        {
+            if (file.size() < header_size + sizeof(uint64_t))
+                throw std::runtime_error{"File " + filename.string() + " is not a minimiser file."};
+            read(header_.shape);
+        }
+
+        // The records have a fixed size, so the blocks are given by their positions.
+        size_t const records = (file.size() - (pos - file.data())) / v1_record_size;
+        for (size_t r = 0; r < records; r += v1_records_per_block)
+        {
+            blocks.push_back({static_cast<uint64_t>(pos - file.data()) + r * v1_record_size, 0,
+                              static_cast<uint32_t>(std::min(v1_records_per_block, records - r)), 0});
+        }
+    }
+}
+
+// Read the block directory at the end of the file or, for files without it, collect the block headers.
+void minimiser_file_reader::read_directory(minimiser_file_v2_header const & file_header)
+{
+    if (file_header.flags & minimiser_file_flags::block_directory)
+    {
+        size_t const directory_size = file_header.number_of_blocks * sizeof(minimiser_block_entry);
+        if ((file_header.number_of_blocks > file.size() / sizeof(minimiser_block_entry)) ||
+            (file.size() - directory_size < file_header.blocks_offset))
+            throw std::runtime_error{"The minimiser file " + filename.string() + " is truncated or corrupted."};
+        blocks.resize(file_header.number_of_blocks);
+        std::memcpy(blocks.data(), file.data() + file.size() - directory_size, directory_size);
+        if (file_header.flags & minimiser_file_flags::count_histogram)
+            histogram_end = file.size() - directory_size;
+        return;
+    }
+
+    uint64_t offset = file_header.blocks_offset;
+    for (uint64_t b = 0; b < file_header.number_of_blocks; ++b)
+    {
+        minimiser_block_header block{};
+        if ((offset > file.size()) || (file.size() - offset < sizeof(block)))
+            throw std::runtime_error{"The minimiser file " + filename.string() + " is truncated or corrupted."};
+        std::memcpy(&block, file.data() + offset, sizeof(block));
+        blocks.push_back({offset, block.first_minimiser, block.number_of_minimisers, 0});
+        offset += sizeof(block) + block.size;
+    }
+    if (file_header.flags & minimiser_file_flags::count_histogram)
+        histogram_end = file.size();
+}
+
+bool minimiser_file_reader::read_histogram(std::vector<uint64_t> & histogram) const
+{
+    if (histogram_end == 0)
+        return false;
+
+    uint64_t number_of_counts{0};
+    if (histogram_end < sizeof(minimiser_file_v2_header) + sizeof(number_of_counts))
+        throw std::runtime_error{"The minimiser file " + filename.string() + " is truncated or corrupted."};
+    std::memcpy(&number_of_counts, file.data() + histogram_end - sizeof(number_of_counts), sizeof(number_of_counts));
+    size_t const entry_size = 2 * sizeof(uint64_t);
+    if (number_of_counts > (histogram_end - sizeof(minimiser_file_v2_header) - sizeof(number_of_counts)) / entry_size)
+        throw std::runtime_error{"The minimiser file " + filename.string() + " is truncated or corrupted."};
+
+    histogram.assign(65536, 0);
+    char const * entry = file.data() + histogram_end - sizeof(number_of_counts) - number_of_counts * entry_size;
+    for (uint64_t i = 0; i < number_of_counts; ++i, entry += entry_size)
+    {
+        uint64_t count;
+        std::memcpy(&count, entry, sizeof(count));
+        if (count >= histogram.size())
+            throw std::runtime_error{"The minimiser file " + filename.string() + " is truncated or corrupted."};
+        std::memcpy(&histogram[count], entry + sizeof(count), sizeof(uint64_t));
+    }
+    return true;
+}
+
+void minimiser_file_reader::read_block(size_t const b, std::vector<uint64_t> & minimisers,
+                                       std::vector<uint16_t> & counts) const
+{
+    minimiser_block_entry const & entry = blocks[b];
+    minimisers.resize(entry.number_of_minimisers);
+    counts.resize(entry.number_of_minimisers);
+
+    if (header_.version == 1)
+    {
+        // Records of 10 bytes, which are not aligned.
+        char const * record = file.data() + entry.offset;
+        for (size_t r = 0; r < minimisers.size(); ++r, record += v1_record_size)
+        {
+            std::memcpy(&minimisers[r], record, sizeof(uint64_t));
+            std::memcpy(&counts[r], record + sizeof(uint64_t), sizeof(uint16_t));
+        }
+        return;
+    }
+
+    minimiser_block_header block{};
+    if ((entry.offset > file.size()) || (file.size() - entry.offset < sizeof(block)))
+        throw std::runtime_error{"The minimiser file " + filename.string() + " is truncated or corrupted."};
+    std::memcpy(&block, file.data() + entry.offset, sizeof(block));
+    size_t const position = entry.offset + sizeof(block);
+    if ((file.size() - position < block.size) || (block.number_of_minimisers != entry.number_of_minimisers) ||
+        (block.number_of_minimisers == 0))
+        throw std::runtime_error{"The minimiser file " + filename.string() + " is truncated or corrupted."};
+
+    uint8_t const * pos = reinterpret_cast<uint8_t const *>(file.data() + position);
+    uint8_t const * const end = pos + block.size;
+    minimisers[0] = block.first_minimiser;
+    for (size_t i = 1; i < minimisers.size(); ++i)
+        minimisers[i] = minimisers[i - 1] + read_varint(pos, end);
+    for (size_t i = 0; i < counts.size(); ++i)
+        counts[i] = read_varint(pos, end);
+}
@@ -0,0 +1,118 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/needle/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <utility>
+
+#include <seqan3/search/views/minimiser_hash.hpp>
+
+#include "minimiser_hash.h"
+
+// Minimisers of an ungapped shape of size k. Every step adds one base to the k-mer hash of the forward strand and of
+// the reverse complement, the window minimum is kept in a queue of increasing values.
+// The minimisers are reported as by seqan3::views::minimiser: The first window gives a minimiser, afterwards a new one
+// is reported if the current minimiser leaves the window or a smaller value enters it. If several values in a window
+// are minimal, the rightmost one is taken.
+template <uint8_t k>
+void ungapped_minimisers(seqan3::dna4_vector const & seq, uint64_t const seed, size_t const window_kmers,
+                         std::vector<uint64_t> & minimisers)
+{
+    static constexpr uint64_t mask = (k == 32) ? ~0ULL : (1ULL << (2 * k)) - 1;
+    static constexpr int rc_shift = 2 * (k - 1);
+
+    minimisers.clear();
+    if (seq.size() < k)
+        return;
+
+    size_t const number_of_kmers = seq.size() - k + 1;
+    size_t const window = std::min(window_kmers, number_of_kmers);
+
+    // Ring buffer of (value, position) with increasing values, the front is the minimum of the window. It is kept per
+    // thread and only grows, so no allocation happens per sequence.
+    thread_local std::vector<std::pair<uint64_t, size_t>> queue{};
+    size_t const size = window + 1;
+    if (queue.size() < size)
+        queue.resize(size);
+    size_t head{0};
+    size_t tail{0}; // one past the last element
+    auto next = [size] (size_t const i) { return (i + 1 == size) ? 0 : i + 1; };
+    auto prev = [size] (size_t const i) { return (i == 0) ? size - 1 : i - 1; };
+
+    uint64_t forward{0};
+    uint64_t reverse{0};
+    for (size_t i = 0; i + 1 < k; ++i)
+    {
+        uint64_t const rank = seqan3::to_rank(seq[i]);
+        forward = ((forward << 2) | rank) & mask;
+        reverse = (reverse >> 2) | ((3 - rank) << rc_shift);
+    }
+
+    uint64_t minimiser_value{0};
+    size_t minimiser_position{0};
+    for (size_t pos = 0; pos < number_of_kmers; ++pos)
+    {
+        uint64_t const rank = seqan3::to_rank(seq[pos + k - 1]);
+        forward = ((forward << 2) | rank) & mask;
+        reverse = (reverse >> 2) | ((3 - rank) << rc_shift);
+        uint64_t const value = std::min(forward ^ seed, reverse ^ seed);
+
+        // Remove larger or equal values, so the rightmost minimum stays in front.
+        while ((head != tail) && (queue[prev(tail)].first >= value))
+            tail = prev(tail);
+        queue[tail] = {value, pos};
+        tail = next(tail);
+        if (queue[head].second + window <= pos)
+            head = next(head);
+
+        if (pos + 1 < window)
+            continue;
+
+        if ((pos + 1 == window) || (minimiser_position + window == pos))
+        {
+            minimiser_value = queue[head].first;
+            minimiser_position = queue[head].second;
+            minimisers.push_back(minimiser_value);
+        }
+        else if (value < minimiser_value)
+        {
+            minimiser_value = value;
+            minimiser_position = pos;
+            minimisers.push_back(minimiser_value);
+        }
+    }
+}
+
+using ungapped_minimisers_t = void (*)(seqan3::dna4_vector const &, uint64_t, size_t, std::vector<uint64_t> &);
+
+template <size_t ... ks>
+constexpr std::array<ungapped_minimisers_t, sizeof...(ks)> make_ungapped_minimisers(std::index_sequence<ks...>)
+{
+    return {&ungapped_minimisers<static_cast<uint8_t>(ks + 1)>...};
+}
+
+// ungapped_minimisers_for_k[k - 1] calculates the minimisers for k = 1, ..., 32.
+static constexpr auto ungapped_minimisers_for_k = make_ungapped_minimisers(std::make_index_sequence<32>{});
+
+void compute_minimisers(min_arguments const & args, seqan3::dna4_vector const & seq, std::vector<uint64_t> & minimisers)
+{
+    size_t const k = args.shape.size();
+
+    if (!args.shape.all() || (k == 0) || (k > 32))
+    {
+        minimisers.clear();
+        for (auto && minHash : seqan3::views::minimiser_hash(seq, args.shape, args.w_size, args.s))
+            minimisers.push_back(minHash);
+        return;
+    }
+
+    if (k > args.w_size.get())
+        throw std::invalid_argument{"The size of the shape cannot be greater than the window size."};
+
+    ungapped_minimisers_for_k[k - 1](seq, args.s.get(), args.w_size.get() - k + 1, minimisers);
+}
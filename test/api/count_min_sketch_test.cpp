@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+
+#include "count_min_sketch.h"
+
+TEST(count_min_sketch, increment)
+{
+    count_min_sketch sketch{1024};
+    EXPECT_EQ(1024, sketch.size_in_bytes());
+    EXPECT_EQ(0, sketch.estimate(27));
+
+    EXPECT_EQ(0, sketch.increment(27));
+    EXPECT_EQ(1, sketch.increment(27));
+    EXPECT_EQ(2, sketch.increment(27));
+    EXPECT_EQ(3, sketch.estimate(27));
+}
+
+TEST(count_min_sketch, saturation)
+{
+    count_min_sketch sketch{1024};
+    for (size_t i = 0; i < 300; ++i)
+        sketch.increment(5);
+    EXPECT_EQ(255, sketch.estimate(5));
+    EXPECT_EQ(255, sketch.increment(5));
+}
+
+// Estimates are never smaller than the true count, even if the sketch is much smaller than the number of keys.
+TEST(count_min_sketch, overestimate_only)
+{
+    count_min_sketch sketch{4096};
+    std::unordered_map<uint64_t, uint16_t> expected{};
+    std::mt19937_64 gen{42};
+    std::uniform_int_distribution<uint64_t> dist{0, 5000};
+
+    for (size_t i = 0; i < 20'000; ++i)
+    {
+        uint64_t const key = dist(gen);
+        sketch.increment(key);
+        expected[key]++;
+    }
+
+    for (auto && elem : expected)
+        EXPECT_GE(sketch.estimate(elem.first), std::min<uint16_t>(255, elem.second));
+}
+
+// A minimiser counted from the moment its estimate passes the cutoff is never counted less often than it occurs, even if
+// a tiny sketch lets the estimate pass the cutoff before the minimiser itself does.
+TEST(count_min_sketch, increment_above)
+{
+    uint8_t const cutoff{3};
+    count_min_sketch sketch{8};
+    std::unordered_map<uint64_t, uint16_t> expected{};
+    std::unordered_map<uint64_t, uint16_t> counted{};
+    std::mt19937_64 gen{42};
+    std::uniform_int_distribution<uint64_t> dist{0, 200};
+
+    for (size_t i = 0; i < 2'000; ++i)
+    {
+        uint64_t const key = dist(gen);
+        expected[key]++;
+        if (auto it = counted.find(key); it != counted.end())
+            it->second++;
+        else if (uint16_t const estimate = sketch.increment_above(key, cutoff); estimate > 0)
+            counted[key] = estimate;
+    }
+
+    for (auto && elem : expected)
+    {
+        if (elem.second > cutoff)
+            EXPECT_GE(counted[elem.first], elem.second);
+    }
+
+    count_min_sketch empty_sketch{1024};
+    EXPECT_EQ(0, empty_sketch.increment_above(27, 1));
+    EXPECT_EQ(2, empty_sketch.increment_above(27, 1));
+}
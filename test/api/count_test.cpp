@@ -23,12 +23,23 @@ void initialization_args(estimate_ibf_arguments & args)
     args.path_out = tmp_dir/"Count_Test_";
 }
 
+// Sequence files given as include, exclude or genome file are copied into a temporary directory, so the caches of their
+// minimisers, which are stored next to them, are not written into the test data.
+std::filesystem::path data_copy(std::string const & filename)
+{
+    std::filesystem::path const data_dir = std::filesystem::temp_directory_path()/"Count_Test_Data";
+    std::filesystem::create_directories(data_dir);
+    std::filesystem::copy_file(std::string(DATA_INPUT_DIR) + filename, data_dir/filename,
+                               std::filesystem::copy_options::skip_existing);
+    return data_dir/filename;
+}
+
 TEST(count, small_example)
 {
     estimate_ibf_arguments args{};
     initialization_args(args);
 
-    count(args, {std::string(DATA_INPUT_DIR) + "mini_example.fasta"}, std::string(DATA_INPUT_DIR) + "mini_gen.fasta", "",
+    count(args, {std::string(DATA_INPUT_DIR) + "mini_example.fasta"}, data_copy("mini_gen.fasta"), "",
           false);
 
     std::ifstream output_file(tmp_dir/"mini_example.count.out");
@@ -43,6 +54,7 @@ TEST(count, small_example)
         output_file.close();
     }
     std::filesystem::remove(tmp_dir/"Count_Test_mini_example.count.out");
+    std::filesystem::remove_all(std::filesystem::temp_directory_path()/"Count_Test_Data");
 }
 
 TEST(count, small_example_paired)
@@ -51,7 +63,7 @@ TEST(count, small_example_paired)
     initialization_args(args);
 
     count(args, {std::string(DATA_INPUT_DIR) + "mini_example.fasta", std::string(DATA_INPUT_DIR) + "mini_example.fasta"},
-          std::string(DATA_INPUT_DIR) + "mini_gen.fasta", "", true);
+          data_copy("mini_gen.fasta"), "", true);
 
     std::ifstream output_file(tmp_dir/"mini_example.count.out");
     std::string line;
@@ -65,6 +77,7 @@ TEST(count, small_example_paired)
         output_file.close();
     }
     std::filesystem::remove(tmp_dir/"Count_Test_mini_example.count.out");
+    std::filesystem::remove_all(std::filesystem::temp_directory_path()/"Count_Test_Data");
 }
 
 TEST(count, small_example_exclude)
@@ -72,8 +85,8 @@ TEST(count, small_example_exclude)
     estimate_ibf_arguments args{};
     initialization_args(args);
 
-    count(args, {std::string(DATA_INPUT_DIR) + "mini_example.fasta"}, std::string(DATA_INPUT_DIR) + "mini_gen.fasta",
-                 std::string(DATA_INPUT_DIR) + "mini_gen2.fasta", false);
+    count(args, {std::string(DATA_INPUT_DIR) + "mini_example.fasta"}, data_copy("mini_gen.fasta"),
+                 data_copy("mini_gen2.fasta"), false);
 
     std::ifstream output_file(tmp_dir/"mini_example.count.out");
     std::string line;
@@ -87,4 +100,5 @@ TEST(count, small_example_exclude)
         output_file.close();
     }
     std::filesystem::remove(tmp_dir/"Count_Test_mini_example.count.out");
+    std::filesystem::remove_all(std::filesystem::temp_directory_path()/"Count_Test_Data");
 }
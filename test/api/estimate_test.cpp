@@ -269,6 +269,54 @@ TEST(estimate, small_example_different_expressions_per_level_normalization_1_unc
     std::filesystem::remove(tmp_dir/"Estimate_Test2_mini_example.minimiser");
 }
 
+// The estimation of an index with several partitions per level is the same as the one of an unpartitioned index.
+TEST(estimate, small_example_partitions)
+{
+    std::filesystem::path tmp_dir = std::filesystem::temp_directory_path(); // get the temp directory
+    std::vector<std::filesystem::path> sequence_files = {std::string(DATA_INPUT_DIR) + "mini_example.fasta",
+                                                         std::string(DATA_INPUT_DIR) + "mini_example2.fasta",
+                                                         std::string(DATA_INPUT_DIR) + "mini_example.fasta"};
+    std::vector<std::string> results{};
+    for (uint8_t partitions : {1, 2})
+    {
+        estimate_ibf_arguments ibf_args{};
+        minimiser_arguments minimiser_args{};
+        estimate_arguments estimate_args{};
+        initialization_args(ibf_args);
+        ibf_args.path_out = tmp_dir/"Estimate_Test_";
+        ibf_args.compressed = false;
+        ibf_args.partitions = partitions;
+        ibf_args.expression_thresholds = {1, 2, 4};
+        std::vector<double> fpr = {0.05};
+        estimate_args.search_file = std::string(DATA_INPUT_DIR) + "mini_gen.fasta";
+        estimate_args.path_in = ibf_args.path_out;
+        std::vector<uint8_t> cutoffs{};
+
+        ibf(sequence_files, ibf_args, minimiser_args, fpr, cutoffs);
+        EXPECT_EQ(partitions > 1, std::filesystem::exists(tmp_dir/"Estimate_Test_IBF_Partitions.partitions"));
+        ibf_args.path_out = tmp_dir/"expression.out";
+        call_estimate(ibf_args, estimate_args);
+
+        std::ifstream output_file(tmp_dir/"expression.out");
+        std::string line;
+        std::getline(output_file, line);
+        results.push_back(line);
+    }
+    EXPECT_EQ(results[0], results[1]);
+    EXPECT_EQ("gen1\t3\t", results[0].substr(0, 7));
+
+    for (std::string threshold : {"1", "2", "4"})
+    {
+        std::filesystem::remove(tmp_dir/("Estimate_Test_IBF_" + threshold));
+        for (std::string partition : {"0", "1"})
+            std::filesystem::remove(tmp_dir/("Estimate_Test_IBF_" + threshold + "_Partition_" + partition));
+    }
+    std::filesystem::remove(tmp_dir/"Estimate_Test_IBF_Partitions.partitions");
+    std::filesystem::remove(tmp_dir/"Estimate_Test_IBF_Data");
+    std::filesystem::remove(tmp_dir/"Estimate_Test_IBF_FPRs.fprs");
+    std::filesystem::remove(tmp_dir/"expression.out");
+}
+
 TEST(estimate, example)
 {
     std::filesystem::path tmp_dir = std::filesystem::temp_directory_path(); // get the temp directory
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <iostream>
+#include <map>
+#include <random>
+#include <unordered_map>
+
+#include "flat_counter_table.h"
+
+TEST(flat_counter_table, insert_find)
+{
+    flat_counter_table<uint16_t> table{};
+    EXPECT_TRUE(table.empty());
+    EXPECT_TRUE(table.find(0) == table.end());
+
+    table[0] = 2;
+    table[27] = 5;
+    table[27]++;
+    EXPECT_EQ(2, table.size());
+    EXPECT_EQ(2, table.find(0)->second);
+    EXPECT_EQ(6, table[27]);
+    EXPECT_TRUE(table.contains(27));
+    EXPECT_FALSE(table.contains(28));
+
+    table.clear();
+    EXPECT_EQ(0, table.size());
+    EXPECT_FALSE(table.contains(27));
+}
+
+// The largest hash marks empty slots internally, but is a valid minimiser for k = 32.
+TEST(flat_counter_table, largest_key)
+{
+    flat_counter_table<uint8_t> table{};
+    uint64_t const largest = std::numeric_limits<uint64_t>::max();
+    table[largest] = 3;
+    table[1] = 1;
+    EXPECT_EQ(2, table.size());
+    EXPECT_EQ(3, table.find(largest)->second);
+
+    uint64_t sum{0};
+    for (auto && elem : table)
+        sum += elem.second;
+    EXPECT_EQ(4, sum);
+
+    table.erase(largest);
+    EXPECT_EQ(1, table.size());
+    EXPECT_FALSE(table.contains(largest));
+}
+
+// Compare random inserts and erases with std::unordered_map, this checks that erasing keeps all probe sequences intact.
+TEST(flat_counter_table, compare_with_map)
+{
+    flat_counter_table<uint16_t> table{};
+    std::unordered_map<uint64_t, uint16_t> expected{};
+    std::mt19937_64 gen{42};
+    std::uniform_int_distribution<uint64_t> dist{0, 5000};
+
+    for (size_t i = 0; i < 100'000; ++i)
+    {
+        uint64_t const key = dist(gen);
+        if (gen() % 3 == 0)
+        {
+            table.erase(key);
+            expected.erase(key);
+        }
+        else
+        {
+            table[key]++;
+            expected[key]++;
+        }
+    }
+
+    EXPECT_EQ(expected.size(), table.size());
+    for (auto && elem : expected)
+        EXPECT_EQ(elem.second, table.find(elem.first)->second);
+
+    size_t iterated{0};
+    for (auto && elem : table)
+    {
+        EXPECT_EQ(expected[elem.first], elem.second);
+        ++iterated;
+    }
+    EXPECT_EQ(expected.size(), iterated);
+}
+
+TEST(flat_counter_table, erase_if)
+{
+    flat_counter_table<uint16_t> table{};
+    std::unordered_map<uint64_t, uint16_t> expected{};
+    for (uint64_t key = 0; key < 10'000; ++key)
+    {
+        table[key] = key % 7;
+        if (key % 7 > 2)
+            expected[key] = key % 7;
+    }
+    table[std::numeric_limits<uint64_t>::max()] = 1;
+
+    table.erase_if([] (uint64_t const, uint16_t const count) { return count <= 2; });
+
+    EXPECT_EQ(expected.size(), table.size());
+    for (auto && elem : expected)
+        EXPECT_EQ(elem.second, table.find(elem.first)->second);
+}
+
+TEST(flat_counter_table, extract_sorted)
+{
+    flat_counter_table<uint16_t> table{};
+    std::map<uint64_t, uint16_t> expected{};
+    std::mt19937_64 gen{42};
+    for (size_t i = 0; i < 50'000; ++i)
+    {
+        uint64_t const key = gen() >> (i % 64);
+        table[key] = i % 1000;
+        expected[key] = i % 1000;
+    }
+    table[std::numeric_limits<uint64_t>::max()] = 1;
+    expected[std::numeric_limits<uint64_t>::max()] = 1;
+
+    std::vector<std::pair<uint64_t, uint16_t>> extracted{};
+    table.extract_sorted([&] (uint64_t const key, uint16_t const count) { extracted.emplace_back(key, count); });
+    EXPECT_EQ((std::vector<std::pair<uint64_t, uint16_t>>(expected.begin(), expected.end())), extracted);
+    EXPECT_TRUE(table.empty());
+}
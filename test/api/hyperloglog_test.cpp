@@ -0,0 +1,36 @@
+#include <gtest/gtest.h>
+#include <iostream>
+#include <random>
+
+#include "hyperloglog.h"
+
+TEST(hyperloglog, small)
+{
+    hyperloglog sketch{};
+    EXPECT_EQ(0, sketch.estimate());
+
+    for (uint64_t minimiser = 0; minimiser < 12; ++minimiser)
+    {
+        sketch.add(minimiser);
+        sketch.add(minimiser);
+    }
+    EXPECT_EQ(12, sketch.estimate());
+}
+
+// Large numbers of distinct minimisers are estimated within a few standard errors.
+TEST(hyperloglog, large)
+{
+    hyperloglog sketch{};
+    std::mt19937_64 gen{42};
+    std::vector<uint64_t> minimisers(200'000);
+    for (auto & minimiser : minimisers)
+        minimiser = gen();
+
+    for (size_t repetition = 0; repetition < 3; ++repetition)
+    {
+        for (uint64_t const minimiser : minimisers)
+            sketch.add(minimiser);
+    }
+
+    EXPECT_NEAR(200'000.0, sketch.estimate(), 200'000.0 * 0.03);
+}
@@ -22,6 +22,17 @@ void initialization_args(estimate_ibf_arguments & args)
     args.s = seqan3::seed{0};
 }
 
+// Sequence files given as include, exclude or genome file are copied into a temporary directory, so the caches of their
+// minimisers, which are stored next to them, are not written into the test data.
+std::filesystem::path data_copy(std::string const & filename)
+{
+    std::filesystem::path const data_dir = std::filesystem::temp_directory_path()/"IBF_Test_Data";
+    std::filesystem::create_directories(data_dir);
+    std::filesystem::copy_file(std::string(DATA_INPUT_DIR) + filename, data_dir/filename,
+                               std::filesystem::copy_options::skip_existing);
+    return data_dir/filename;
+}
+
 TEST(ibf, given_expression_thresholds)
 {
     std::filesystem::path tmp_dir = std::filesystem::temp_directory_path(); // get the temp directory
@@ -75,6 +86,70 @@ TEST(ibf, given_expression_thresholds)
     std::filesystem::remove(tmp_dir/"IBF_Test_Exp_IBF_FPRs.fprs");
 }
 
+// The minimisers of mini_example.fasta occur once (3 minimisers) or more often (9 minimisers), the sketches count them
+// exactly and the IBFs are sized by these numbers.
+TEST(ibf, given_expression_thresholds_size_sketch)
+{
+    std::filesystem::path tmp_dir = std::filesystem::temp_directory_path(); // get the temp directory
+    estimate_ibf_arguments ibf_args{};
+    minimiser_arguments minimiser_args{};
+    initialization_args(ibf_args);
+    ibf_args.path_out = tmp_dir/"IBF_Test_Size_Sketch_";
+    ibf_args.expression_thresholds = {1, 2};
+    minimiser_args.size_sketch_memory = 1;
+    std::vector<std::filesystem::path> sequence_files = {std::string(DATA_INPUT_DIR) + "mini_example.fasta"};
+    std::vector<double> fpr = {0.05};
+    std::vector<uint8_t> cutoffs{0};
+
+    ibf(sequence_files, ibf_args, minimiser_args, fpr, cutoffs);
+
+    std::vector<uint64_t> expected_sizes{3, 9};
+    for (size_t j = 0; j < expected_sizes.size(); ++j)
+    {
+        seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed> ibf;
+        load_ibf(ibf, tmp_dir/("IBF_Test_Size_Sketch_IBF_" + std::to_string(j + 1)));
+        // m = -hn/ln(1-p^(1/h))
+        EXPECT_EQ(static_cast<uint64_t>(-1.0 * expected_sizes[j] / std::log(1.0 - 0.05)), ibf.bin_size());
+    }
+
+    std::filesystem::remove(tmp_dir/"IBF_Test_Size_Sketch_IBF_1");
+    std::filesystem::remove(tmp_dir/"IBF_Test_Size_Sketch_IBF_2");
+    std::filesystem::remove(tmp_dir/"IBF_Test_Size_Sketch_IBF_Data");
+    std::filesystem::remove(tmp_dir/"IBF_Test_Size_Sketch_IBF_FPRs.fprs");
+}
+
+// With a cutoff of 1, the minimisers occurring once (3 minimisers) are not stored in the first level, although they reach
+// its expression threshold. The other minimisers occur twice (2 minimisers) or at least three times (7 minimisers).
+TEST(ibf, given_expression_thresholds_size_sketch_cutoff)
+{
+    std::filesystem::path tmp_dir = std::filesystem::temp_directory_path(); // get the temp directory
+    estimate_ibf_arguments ibf_args{};
+    minimiser_arguments minimiser_args{};
+    initialization_args(ibf_args);
+    ibf_args.path_out = tmp_dir/"IBF_Test_Size_Sketch_Cutoff_";
+    ibf_args.expression_thresholds = {1, 3};
+    minimiser_args.size_sketch_memory = 1;
+    std::vector<std::filesystem::path> sequence_files = {std::string(DATA_INPUT_DIR) + "mini_example.fasta"};
+    std::vector<double> fpr = {0.05};
+    std::vector<uint8_t> cutoffs{1};
+
+    ibf(sequence_files, ibf_args, minimiser_args, fpr, cutoffs);
+
+    std::vector<uint64_t> expected_sizes{2, 7};
+    for (size_t j = 0; j < expected_sizes.size(); ++j)
+    {
+        std::string const filename = "IBF_Test_Size_Sketch_Cutoff_IBF_" + std::to_string(ibf_args.expression_thresholds[j]);
+        seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed> ibf;
+        load_ibf(ibf, tmp_dir/filename);
+        // m = -hn/ln(1-p^(1/h))
+        EXPECT_EQ(static_cast<uint64_t>(-1.0 * expected_sizes[j] / std::log(1.0 - 0.05)), ibf.bin_size());
+        std::filesystem::remove(tmp_dir/filename);
+    }
+
+    std::filesystem::remove(tmp_dir/"IBF_Test_Size_Sketch_Cutoff_IBF_Data");
+    std::filesystem::remove(tmp_dir/"IBF_Test_Size_Sketch_Cutoff_IBF_FPRs.fprs");
+}
+
 TEST(ibf, given_expression_thresholds_include_file)
 {
     std::filesystem::path tmp_dir = std::filesystem::temp_directory_path(); // get the temp directory
@@ -83,7 +158,7 @@ TEST(ibf, given_expression_thresholds_include_file)
     initialization_args(ibf_args);
     ibf_args.path_out = tmp_dir/"IBF_Test_Include_";
     ibf_args.expression_thresholds = {1, 2};
-    minimiser_args.include_file = std::string(DATA_INPUT_DIR) + "mini_example.fasta";
+    minimiser_args.include_file = data_copy("mini_example.fasta");
     std::vector<std::filesystem::path> sequence_files = {std::string(DATA_INPUT_DIR) + "mini_example.fasta"};
     std::vector<double> fpr = {0.05};
 
@@ -111,6 +186,7 @@ TEST(ibf, given_expression_thresholds_include_file)
     std::filesystem::remove(tmp_dir/"IBF_Test_Include_IBF_2");
     std::filesystem::remove(tmp_dir/"IBF_Test_Include_IBF_Data");
     std::filesystem::remove(tmp_dir/"IBF_Test_Include_IBF_FPRs.fprs");
+    std::filesystem::remove_all(std::filesystem::temp_directory_path()/"IBF_Test_Data");
 }
 
 TEST(ibf, given_expression_thresholds_exclude_file)
@@ -121,7 +197,7 @@ TEST(ibf, given_expression_thresholds_exclude_file)
     initialization_args(ibf_args);
     ibf_args.path_out = tmp_dir/"IBF_Test_Exclude_";
     ibf_args.expression_thresholds = {1, 2};
-    minimiser_args.exclude_file = std::string(DATA_INPUT_DIR) + "mini_gen.fasta";
+    minimiser_args.exclude_file = data_copy("mini_gen.fasta");
     std::vector<std::filesystem::path> sequence_files = {std::string(DATA_INPUT_DIR) + "mini_example.fasta"};
     std::vector<double> fpr = {0.05};
 
@@ -149,6 +225,7 @@ TEST(ibf, given_expression_thresholds_exclude_file)
     std::filesystem::remove(tmp_dir/"IBF_Test_Exclude_IBF_2");
     std::filesystem::remove(tmp_dir/"IBF_Test_Exclude_IBF_Data");
     std::filesystem::remove(tmp_dir/"IBF_Test_Exclude_IBF_FPRs.fprs");
+    std::filesystem::remove_all(std::filesystem::temp_directory_path()/"IBF_Test_Data");
 }
 
 TEST(ibf, no_given_expression_thresholds)
@@ -190,6 +267,154 @@ TEST(ibf, no_given_expression_thresholds)
     std::filesystem::remove(tmp_dir/"IBF_Test_IBF_FPRs.fprs");
 }
 
+// Counting with temporary files has to give the same levels and IBFs as counting in memory.
+TEST(ibf, no_given_expression_thresholds_max_memory)
+{
+    std::filesystem::path tmp_dir = std::filesystem::temp_directory_path(); // get the temp directory
+    estimate_ibf_arguments ibf_args{};
+    minimiser_arguments minimiser_args{};
+    initialization_args(ibf_args);
+    ibf_args.path_out = tmp_dir/"IBF_Test_";
+    ibf_args.number_expression_thresholds = 2;
+    std::vector<std::filesystem::path> sequence_files = {std::string(DATA_INPUT_DIR) + "mini_example.fasta"};
+    std::vector<double> fpr = {0.05};
+    std::vector<uint8_t> cutoffs{0};
+    ibf(sequence_files, ibf_args, minimiser_args, fpr, cutoffs);
+
+    estimate_ibf_arguments ibf_args_memory{};
+    initialization_args(ibf_args_memory);
+    ibf_args_memory.path_out = tmp_dir/"IBF_Test_Memory_";
+    ibf_args_memory.number_expression_thresholds = 2;
+    minimiser_args.max_memory = 1;
+    ibf(sequence_files, ibf_args_memory, minimiser_args, fpr, cutoffs);
+
+    std::ifstream levels{tmp_dir/"IBF_Test_IBF_Levels.levels"};
+    std::ifstream levels_memory{tmp_dir/"IBF_Test_Memory_IBF_Levels.levels"};
+    std::string content{std::istreambuf_iterator<char>{levels}, std::istreambuf_iterator<char>{}};
+    std::string content_memory{std::istreambuf_iterator<char>{levels_memory}, std::istreambuf_iterator<char>{}};
+    EXPECT_EQ(content, content_memory);
+
+    for (std::string level : {"0", "1"})
+    {
+        seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed> ibf;
+        seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed> ibf_memory;
+        load_ibf(ibf, tmp_dir/("IBF_Test_IBF_Level_" + level));
+        load_ibf(ibf_memory, tmp_dir/("IBF_Test_Memory_IBF_Level_" + level));
+        EXPECT_TRUE(ibf == ibf_memory);
+    }
+    EXPECT_FALSE(std::filesystem::exists(tmp_dir/"IBF_Test_Memory_mini_example.counts"));
+
+    for (std::string prefix : {"IBF_Test_", "IBF_Test_Memory_"})
+    {
+        std::filesystem::remove(tmp_dir/(prefix + "IBF_Level_0"));
+        std::filesystem::remove(tmp_dir/(prefix + "IBF_Level_1"));
+        std::filesystem::remove(tmp_dir/(prefix + "IBF_Levels.levels"));
+        std::filesystem::remove(tmp_dir/(prefix + "IBF_Data"));
+        std::filesystem::remove(tmp_dir/(prefix + "IBF_FPRs.fprs"));
+    }
+}
+
+// A build with checkpoints gives the same index and removes its checkpoints. A resumed build skips the samples finished in
+// the checkpoint, so a bin cleared in the checkpoint stays empty.
+TEST(ibf, checkpoint_resume)
+{
+    std::filesystem::path tmp_dir = std::filesystem::temp_directory_path(); // get the temp directory
+    std::vector<std::filesystem::path> sequence_files = {std::string(DATA_INPUT_DIR) + "mini_example.fasta",
+                                                         std::string(DATA_INPUT_DIR) + "mini_example2.fasta",
+                                                         std::string(DATA_INPUT_DIR) + "mini_example.fasta"};
+    std::string const prefix = (tmp_dir/"IBF_Test_Checkpoint_").string();
+    auto build = [&] (minimiser_arguments minimiser_args)
+    {
+        estimate_ibf_arguments ibf_args{};
+        initialization_args(ibf_args);
+        ibf_args.compressed = false;
+        ibf_args.number_expression_thresholds = 2;
+        ibf_args.path_out = prefix;
+        std::vector<double> fpr = {0.05};
+        std::vector<uint8_t> cutoffs{0, 0, 0};
+        ibf(sequence_files, ibf_args, minimiser_args, fpr, cutoffs);
+    };
+    auto read_file = [] (std::filesystem::path const & filename)
+    {
+        std::ifstream fin{filename};
+        return std::string{std::istreambuf_iterator<char>{fin}, std::istreambuf_iterator<char>{}};
+    };
+
+    build({});
+    std::vector<seqan3::interleaved_bloom_filter<>> expected(2);
+    for (size_t j = 0; j < 2; j++)
+        load_ibf(expected[j], prefix + "IBF_Level_" + std::to_string(j));
+    std::vector<seqan3::interleaved_bloom_filter<>> const complete = expected;
+    std::string const expected_levels = read_file(prefix + "IBF_Levels.levels");
+
+    minimiser_arguments checkpoint_args{};
+    checkpoint_args.checkpoint_interval = 1;
+    build(checkpoint_args);
+    for (size_t j = 0; j < 2; j++)
+    {
+        seqan3::interleaved_bloom_filter ibf;
+        load_ibf(ibf, prefix + "IBF_Level_" + std::to_string(j));
+        EXPECT_TRUE(expected[j] == ibf);
+        EXPECT_FALSE(std::filesystem::exists(prefix + "IBF_Level_" + std::to_string(j) + ".checkpoint"));
+    }
+    EXPECT_FALSE(std::filesystem::exists(prefix + "IBF_Checkpoint.samples"));
+
+    // The checkpoint of an interrupted build, in which the second sample is finished.
+    std::stringstream levels{expected_levels};
+    std::string line{};
+    std::ofstream checkpoint{prefix + "IBF_Checkpoint.samples"};
+    checkpoint << "3 2\n1";
+    while (std::getline(levels, line) && (line != "/"))
+    {
+        std::stringstream values{line};
+        uint16_t value{};
+        values >> value >> value;
+        checkpoint << " " << value;
+    }
+    checkpoint << "\n";
+    checkpoint.close();
+    for (size_t j = 0; j < 2; j++)
+    {
+        expected[j].clear(seqan3::bin_index{1});
+        store_ibf(expected[j], prefix + "IBF_Level_" + std::to_string(j) + ".checkpoint");
+    }
+
+    minimiser_arguments resume_args{};
+    resume_args.resume = true;
+    build(resume_args);
+    for (size_t j = 0; j < 2; j++)
+    {
+        seqan3::interleaved_bloom_filter ibf;
+        load_ibf(ibf, prefix + "IBF_Level_" + std::to_string(j));
+        EXPECT_TRUE(expected[j] == ibf);
+    }
+    EXPECT_EQ(expected_levels, read_file(prefix + "IBF_Levels.levels"));
+    EXPECT_FALSE(std::filesystem::exists(prefix + "IBF_Checkpoint.samples"));
+
+    // IBFs of a checkpoint without its samples file are not used, the build starts from the beginning.
+    for (size_t j = 0; j < 2; j++)
+    {
+        seqan3::interleaved_bloom_filter<> stale = complete[j];
+        for (uint64_t minHash = 0; minHash < 1000; minHash++)
+            stale.emplace(minHash, seqan3::bin_index{0});
+        store_ibf(stale, prefix + "IBF_Level_" + std::to_string(j) + ".checkpoint");
+    }
+    build(resume_args);
+    for (size_t j = 0; j < 2; j++)
+    {
+        seqan3::interleaved_bloom_filter ibf;
+        load_ibf(ibf, prefix + "IBF_Level_" + std::to_string(j));
+        EXPECT_TRUE(complete[j] == ibf);
+        EXPECT_FALSE(std::filesystem::exists(prefix + "IBF_Level_" + std::to_string(j) + ".checkpoint"));
+    }
+
+    std::filesystem::remove(prefix + "IBF_Level_0");
+    std::filesystem::remove(prefix + "IBF_Level_1");
+    std::filesystem::remove(prefix + "IBF_Levels.levels");
+    std::filesystem::remove(prefix + "IBF_Data");
+    std::filesystem::remove(prefix + "IBF_FPRs.fprs");
+}
+
 TEST(ibf, expression_thresholds_by_genome)
 {
     std::filesystem::path tmp_dir = std::filesystem::temp_directory_path(); // get the temp directory
@@ -205,7 +430,7 @@ TEST(ibf, expression_thresholds_by_genome)
     std::vector<uint8_t> cutoffs{};
 
     std::vector<uint16_t> medians = ibf(sequence_files, ibf_args, minimiser_args, fpr, cutoffs,
-                                        std::string(DATA_INPUT_DIR) + "mini_gen.fasta");
+                                        data_copy("mini_gen.fasta"));
 
     EXPECT_EQ(expected, medians);
 
@@ -227,6 +452,7 @@ TEST(ibf, expression_thresholds_by_genome)
     std::filesystem::remove(tmp_dir/"IBF_Test_IBF_Levels.levels");
     std::filesystem::remove(tmp_dir/"IBF_Test_IBF_Data");
     std::filesystem::remove(tmp_dir/"IBF_Test_IBF_FPRs.fprs");
+    std::filesystem::remove_all(std::filesystem::temp_directory_path()/"IBF_Test_Data");
 }
 
 TEST(ibf, throws)
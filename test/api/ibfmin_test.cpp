@@ -1,9 +1,11 @@
 #include <gtest/gtest.h>
 #include <iostream>
+#include <random>
 
 #include <seqan3/test/expect_range_eq.hpp>
 
 #include "ibf.h"
+#include "minimiser_file.h"
 #include "shared.h"
 
 #ifndef DATA_INPUT_DIR
@@ -23,6 +25,17 @@ void initialization_args(estimate_ibf_arguments & args)
     args.path_out = tmp_dir/"IBFMIN_Test_";
 }
 
+// Sequence files given as include, exclude or genome file are copied into a temporary directory, so the caches of their
+// minimisers, which are stored next to them, are not written into the test data.
+std::filesystem::path data_copy(std::string const & filename)
+{
+    std::filesystem::path const data_dir = std::filesystem::temp_directory_path()/"IBFMIN_Test_Data";
+    std::filesystem::create_directories(data_dir);
+    std::filesystem::copy_file(std::string(DATA_INPUT_DIR) + filename, data_dir/filename,
+                               std::filesystem::copy_options::skip_existing);
+    return data_dir/filename;
+}
+
 TEST(ibfmin, given_expression_thresholds)
 {
     estimate_ibf_arguments ibf_args{};
@@ -138,7 +151,7 @@ TEST(ibfmin, expression_thresholds_by_genome)
 
     std::vector<uint16_t> expected{};
 
-    std::vector<uint16_t> medians = ibf(minimiser_file, ibf_args, fpr, std::string(DATA_INPUT_DIR) + "mini_gen.fasta");
+    std::vector<uint16_t> medians = ibf(minimiser_file, ibf_args, fpr, data_copy("mini_gen.fasta"));
 
     EXPECT_EQ(expected, medians);
 
@@ -160,6 +173,7 @@ TEST(ibfmin, expression_thresholds_by_genome)
     std::filesystem::remove(tmp_dir/"IBFMIN_Test_IBF_Data");
     std::filesystem::remove(tmp_dir/"IBFMIN_Test_IBF_Levels.levels");
     std::filesystem::remove(tmp_dir/"IBFMIN_Test_IBF_FPRs.fprs");
+    std::filesystem::remove_all(std::filesystem::temp_directory_path()/"IBFMIN_Test_Data");
 }
 
 #if defined(__GNUC__) && ((__GNUC___ == 10 && __cplusplus == 201703L) || (__GNUC__ <10))
@@ -238,3 +252,522 @@ TEST(ibfmin, different_shape)
     std::filesystem::remove(tmp_dir/"IBFMIN_Test_Shape_IBF_FPRs.fprs");
     std::filesystem::remove(tmp_dir/("IBFMIN_Test_Shape_mini_example.minimiser"));
 }
+
+// More than 64 bins, so several groups of bins sharing the words of the IBFs are filled by different threads.
+TEST(ibfmin, multiple_threads_many_files)
+{
+    std::vector<std::filesystem::path> minimiser_files(130, std::string(DATA_INPUT_DIR) + "mini_example.minimiser");
+    for (uint8_t threads : {1, 8})
+    {
+        estimate_ibf_arguments ibf_args{};
+        initialization_args(ibf_args);
+        ibf_args.expression_thresholds = {1, 2};
+        ibf_args.threads = threads;
+        ibf_args.path_out = tmp_dir/("IBFMIN_Test_Many_" + std::to_string(threads) + "_");
+        std::vector<double> fpr = {0.05};
+        ibf(minimiser_files, ibf_args, fpr);
+    }
+
+    for (std::string level : {"1", "2"})
+    {
+        seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed> ibf;
+        seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed> ibf_threads;
+        load_ibf(ibf, tmp_dir/("IBFMIN_Test_Many_1_IBF_" + level));
+        load_ibf(ibf_threads, tmp_dir/("IBFMIN_Test_Many_8_IBF_" + level));
+        EXPECT_EQ(130, ibf.bin_count());
+        EXPECT_TRUE(ibf == ibf_threads);
+    }
+
+    for (std::string threads : {"1", "8"})
+    {
+        for (std::string level : {"1", "2"})
+            std::filesystem::remove(tmp_dir/("IBFMIN_Test_Many_" + threads + "_IBF_" + level));
+        std::filesystem::remove(tmp_dir/("IBFMIN_Test_Many_" + threads + "_IBF_Data"));
+        std::filesystem::remove(tmp_dir/("IBFMIN_Test_Many_" + threads + "_IBF_FPRs.fprs"));
+    }
+}
+
+// Fewer samples than 64 per thread, so the samples of one group of 64 bins are counted by different threads at the
+// same time.
+TEST(ibfmin, multiple_threads_few_files)
+{
+    std::vector<std::filesystem::path> minimiser_files(20, std::string(DATA_INPUT_DIR) + "mini_example.minimiser");
+    for (uint8_t threads : {1, 4})
+    {
+        estimate_ibf_arguments ibf_args{};
+        initialization_args(ibf_args);
+        ibf_args.expression_thresholds = {1, 2};
+        ibf_args.threads = threads;
+        ibf_args.path_out = tmp_dir/("IBFMIN_Test_Few_" + std::to_string(threads) + "_");
+        std::vector<double> fpr = {0.05};
+        ibf(minimiser_files, ibf_args, fpr);
+    }
+
+    for (std::string level : {"1", "2"})
+    {
+        seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed> ibf;
+        seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed> ibf_threads;
+        load_ibf(ibf, tmp_dir/("IBFMIN_Test_Few_1_IBF_" + level));
+        load_ibf(ibf_threads, tmp_dir/("IBFMIN_Test_Few_4_IBF_" + level));
+        EXPECT_EQ(20, ibf.bin_count());
+        EXPECT_TRUE(ibf == ibf_threads);
+    }
+
+    for (std::string threads : {"1", "4"})
+    {
+        for (std::string level : {"1", "2"})
+            std::filesystem::remove(tmp_dir/("IBFMIN_Test_Few_" + threads + "_IBF_" + level));
+        std::filesystem::remove(tmp_dir/("IBFMIN_Test_Few_" + threads + "_IBF_Data"));
+        std::filesystem::remove(tmp_dir/("IBFMIN_Test_Few_" + threads + "_IBF_FPRs.fprs"));
+    }
+}
+
+// With two hash functions the minimisers are inserted unsorted, all of them are found in the IBF of their level.
+TEST(ibfmin, two_hash_functions)
+{
+    estimate_ibf_arguments ibf_args{};
+    initialization_args(ibf_args);
+    ibf_args.expression_thresholds = {1, 2};
+    ibf_args.path_out = tmp_dir/"IBFMIN_Test_Hash_";
+    std::vector<double> fpr = {0.05};
+    std::vector<std::filesystem::path> minimiser_file = {std::string(DATA_INPUT_DIR) + "mini_example.minimiser"};
+    ibf(minimiser_file, ibf_args, fpr, "", 2);
+
+    std::vector<seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed>> ibfs(2);
+    load_ibf(ibfs[0], tmp_dir/"IBFMIN_Test_Hash_IBF_1");
+    load_ibf(ibfs[1], tmp_dir/"IBFMIN_Test_Hash_IBF_2");
+    EXPECT_EQ(2, ibfs[0].hash_function_count());
+    minimiser_file_reader fin{minimiser_file[0]};
+    fin.for_each([&] (uint64_t const minHash, uint16_t const minimiser_count)
+    {
+        auto agent = ibfs[(minimiser_count >= 2) ? 1 : 0].membership_agent();
+        EXPECT_TRUE(agent.bulk_contains(minHash)[0]);
+    });
+
+    std::filesystem::remove(tmp_dir/"IBFMIN_Test_Hash_IBF_1");
+    std::filesystem::remove(tmp_dir/"IBFMIN_Test_Hash_IBF_2");
+    std::filesystem::remove(tmp_dir/"IBFMIN_Test_Hash_IBF_Data");
+    std::filesystem::remove(tmp_dir/"IBFMIN_Test_Hash_IBF_FPRs.fprs");
+}
+
+// Building one level after another gives the same IBFs as building all levels at once.
+TEST(ibfmin, levels_in_memory)
+{
+    std::vector<std::filesystem::path> minimiser_file = {std::string(DATA_INPUT_DIR) + "mini_example.minimiser"};
+    for (uint8_t levels_in_memory : {0, 1})
+    {
+        estimate_ibf_arguments ibf_args{};
+        initialization_args(ibf_args);
+        ibf_args.number_expression_thresholds = 3;
+        ibf_args.path_out = tmp_dir/("IBFMIN_Test_Levels_" + std::to_string(levels_in_memory) + "_");
+        std::vector<double> fpr = {0.05};
+        ibf(minimiser_file, ibf_args, fpr, "", 1, levels_in_memory);
+    }
+
+    for (std::string level : {"0", "1", "2"})
+    {
+        seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed> ibf;
+        seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed> ibf_levels;
+        load_ibf(ibf, tmp_dir/("IBFMIN_Test_Levels_0_IBF_Level_" + level));
+        load_ibf(ibf_levels, tmp_dir/("IBFMIN_Test_Levels_1_IBF_Level_" + level));
+        EXPECT_TRUE(ibf == ibf_levels);
+    }
+
+    for (std::string levels_in_memory : {"0", "1"})
+    {
+        for (std::string level : {"0", "1", "2"})
+            std::filesystem::remove(tmp_dir/("IBFMIN_Test_Levels_" + levels_in_memory + "_IBF_Level_" + level));
+        std::filesystem::remove(tmp_dir/("IBFMIN_Test_Levels_" + levels_in_memory + "_IBF_Levels.levels"));
+        std::filesystem::remove(tmp_dir/("IBFMIN_Test_Levels_" + levels_in_memory + "_IBF_Data"));
+        std::filesystem::remove(tmp_dir/("IBFMIN_Test_Levels_" + levels_in_memory + "_IBF_FPRs.fprs"));
+    }
+}
+
+// Appending experiments results in the same index as building it with all experiments at once.
+TEST(ibfmin, append)
+{
+    std::vector<std::filesystem::path> minimiser_files(3, std::string(DATA_INPUT_DIR) + "mini_example.minimiser");
+    for (std::string name : {"All", "Append"})
+    {
+        estimate_ibf_arguments ibf_args{};
+        initialization_args(ibf_args);
+        ibf_args.compressed = false;
+        ibf_args.number_expression_thresholds = 2;
+        ibf_args.path_out = tmp_dir/("IBFMIN_Test_" + name + "_");
+        std::vector<double> fpr = {0.05};
+        if (name == "All")
+        {
+            ibf(minimiser_files, ibf_args, fpr);
+        }
+        else
+        {
+            ibf({minimiser_files[0]}, ibf_args, fpr);
+            estimate_ibf_arguments append_args{};
+            append_args.path_out = ibf_args.path_out;
+            append_args.threads = 2;
+            append({minimiser_files[1], minimiser_files[2]}, append_args);
+        }
+    }
+
+    for (std::string level : {"0", "1"})
+    {
+        seqan3::interleaved_bloom_filter ibf;
+        seqan3::interleaved_bloom_filter ibf_append;
+        load_ibf(ibf, tmp_dir/("IBFMIN_Test_All_IBF_Level_" + level));
+        load_ibf(ibf_append, tmp_dir/("IBFMIN_Test_Append_IBF_Level_" + level));
+        EXPECT_EQ(3, ibf_append.bin_count());
+        EXPECT_TRUE(ibf == ibf_append);
+    }
+
+    std::ifstream levels{tmp_dir/"IBFMIN_Test_All_IBF_Levels.levels"};
+    std::ifstream levels_append{tmp_dir/"IBFMIN_Test_Append_IBF_Levels.levels"};
+    std::string line{};
+    std::string line_append{};
+    while (std::getline(levels, line) && std::getline(levels_append, line_append))
+        EXPECT_EQ(line, line_append);
+    EXPECT_EQ("/", line_append);
+
+    for (std::string name : {"All", "Append"})
+    {
+        for (std::string level : {"0", "1"})
+            std::filesystem::remove(tmp_dir/("IBFMIN_Test_" + name + "_IBF_Level_" + level));
+        std::filesystem::remove(tmp_dir/("IBFMIN_Test_" + name + "_IBF_Levels.levels"));
+        std::filesystem::remove(tmp_dir/("IBFMIN_Test_" + name + "_IBF_Data"));
+        std::filesystem::remove(tmp_dir/("IBFMIN_Test_" + name + "_IBF_FPRs.fprs"));
+    }
+}
+
+// The IBFs of a compressed index are decompressed for appending and compressed again. A missing minimiser file does not
+// change the index.
+TEST(ibfmin, append_compressed)
+{
+    std::vector<std::filesystem::path> minimiser_files(2, std::string(DATA_INPUT_DIR) + "mini_example.minimiser");
+    for (std::string name : {"All", "Append"})
+    {
+        estimate_ibf_arguments ibf_args{};
+        initialization_args(ibf_args);
+        ibf_args.expression_thresholds = {1, 2};
+        ibf_args.path_out = tmp_dir/("IBFMIN_Test_Compressed_" + name + "_");
+        std::vector<double> fpr = {0.05};
+        if (name == "All")
+        {
+            ibf(minimiser_files, ibf_args, fpr);
+        }
+        else
+        {
+            ibf({minimiser_files[0]}, ibf_args, fpr);
+            estimate_ibf_arguments append_args{};
+            append_args.path_out = ibf_args.path_out;
+            EXPECT_THROW(append({tmp_dir/"IBFMIN_Test_Missing.minimiser"}, append_args), std::runtime_error);
+            append({minimiser_files[1]}, append_args);
+        }
+    }
+
+    for (std::string level : {"1", "2"})
+    {
+        seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed> ibf;
+        seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed> ibf_append;
+        load_ibf(ibf, tmp_dir/("IBFMIN_Test_Compressed_All_IBF_" + level));
+        load_ibf(ibf_append, tmp_dir/("IBFMIN_Test_Compressed_Append_IBF_" + level));
+        EXPECT_EQ(2, ibf_append.bin_count());
+        EXPECT_TRUE(ibf == ibf_append);
+        EXPECT_FALSE(std::filesystem::exists(tmp_dir/("IBFMIN_Test_Compressed_Append_IBF_" + level + ".tmp")));
+    }
+
+    for (std::string name : {"All", "Append"})
+    {
+        for (std::string level : {"1", "2"})
+            std::filesystem::remove(tmp_dir/("IBFMIN_Test_Compressed_" + name + "_IBF_" + level));
+        std::filesystem::remove(tmp_dir/("IBFMIN_Test_Compressed_" + name + "_IBF_Data"));
+        std::filesystem::remove(tmp_dir/("IBFMIN_Test_Compressed_" + name + "_IBF_FPRs.fprs"));
+    }
+}
+
+// Replacing an experiment by itself does not change the index, clearing it removes all its minimisers.
+TEST(ibfmin, replace)
+{
+    std::vector<std::filesystem::path> minimiser_files(2, std::string(DATA_INPUT_DIR) + "mini_example.minimiser");
+    estimate_ibf_arguments ibf_args{};
+    initialization_args(ibf_args);
+    ibf_args.compressed = false;
+    ibf_args.number_expression_thresholds = 2;
+    ibf_args.path_out = tmp_dir/"IBFMIN_Test_Replace_";
+    std::vector<double> fpr = {0.05};
+    ibf(minimiser_files, ibf_args, fpr);
+
+    seqan3::interleaved_bloom_filter expected_ibf;
+    load_ibf(expected_ibf, tmp_dir/"IBFMIN_Test_Replace_IBF_Level_0");
+
+    estimate_ibf_arguments replace_args{};
+    replace_args.path_out = ibf_args.path_out;
+    replace(1, minimiser_files[1], replace_args);
+    seqan3::interleaved_bloom_filter ibf;
+    load_ibf(ibf, tmp_dir/"IBFMIN_Test_Replace_IBF_Level_0");
+    EXPECT_TRUE(expected_ibf == ibf);
+
+    replace(0, "", replace_args);
+    load_ibf(ibf, tmp_dir/"IBFMIN_Test_Replace_IBF_Level_0");
+    auto agent = ibf.membership_agent();
+    std::vector<bool> expected_result{0, 1};
+    auto & res = agent.bulk_contains(24);
+    EXPECT_RANGE_EQ(expected_result,  res);
+
+    std::ifstream fprs{tmp_dir/"IBFMIN_Test_Replace_IBF_FPRs.fprs"};
+    std::string line{};
+    while (std::getline(fprs, line) && (line != "/"))
+        EXPECT_EQ("0 ", line.substr(0, 2));
+
+    EXPECT_THROW(replace(2, "", replace_args), std::invalid_argument);
+
+    std::filesystem::remove(tmp_dir/"IBFMIN_Test_Replace_IBF_Level_0");
+    std::filesystem::remove(tmp_dir/"IBFMIN_Test_Replace_IBF_Level_1");
+    std::filesystem::remove(tmp_dir/"IBFMIN_Test_Replace_IBF_Levels.levels");
+    std::filesystem::remove(tmp_dir/"IBFMIN_Test_Replace_IBF_Data");
+    std::filesystem::remove(tmp_dir/"IBFMIN_Test_Replace_IBF_FPRs.fprs");
+}
+
+// A bin of a compressed index is replaced in the decompressed IBFs. A missing minimiser file does not change the index.
+TEST(ibfmin, replace_compressed)
+{
+    std::vector<std::filesystem::path> minimiser_files(2, std::string(DATA_INPUT_DIR) + "mini_example.minimiser");
+    estimate_ibf_arguments ibf_args{};
+    initialization_args(ibf_args);
+    ibf_args.expression_thresholds = {1, 2};
+    ibf_args.path_out = tmp_dir/"IBFMIN_Test_Replace_Compressed_";
+    std::vector<double> fpr = {0.05};
+    ibf(minimiser_files, ibf_args, fpr);
+
+    seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed> expected_ibf;
+    load_ibf(expected_ibf, tmp_dir/"IBFMIN_Test_Replace_Compressed_IBF_1");
+
+    estimate_ibf_arguments replace_args{};
+    replace_args.path_out = ibf_args.path_out;
+    EXPECT_THROW(replace(0, tmp_dir/"IBFMIN_Test_Missing.minimiser", replace_args), std::runtime_error);
+    replace(1, minimiser_files[1], replace_args);
+    seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed> ibf;
+    load_ibf(ibf, tmp_dir/"IBFMIN_Test_Replace_Compressed_IBF_1");
+    EXPECT_TRUE(expected_ibf == ibf);
+
+    replace(0, "", replace_args);
+    load_ibf(ibf, tmp_dir/"IBFMIN_Test_Replace_Compressed_IBF_1");
+    auto agent = ibf.membership_agent();
+    std::vector<bool> expected_result{0, 1};
+    auto & res = agent.bulk_contains(24);
+    EXPECT_RANGE_EQ(expected_result,  res);
+    EXPECT_FALSE(std::filesystem::exists(tmp_dir/"IBFMIN_Test_Replace_Compressed_IBF_1.tmp"));
+
+    std::filesystem::remove(tmp_dir/"IBFMIN_Test_Replace_Compressed_IBF_1");
+    std::filesystem::remove(tmp_dir/"IBFMIN_Test_Replace_Compressed_IBF_2");
+    std::filesystem::remove(tmp_dir/"IBFMIN_Test_Replace_Compressed_IBF_Data");
+    std::filesystem::remove(tmp_dir/"IBFMIN_Test_Replace_Compressed_IBF_FPRs.fprs");
+}
+
+// Merging indexes of disjoint experiments results in the same index as building it with all experiments at once. The
+// bins of the second index do not start at a new word. Both indexes contain both experiments equally often, so they
+// have the same bin sizes.
+TEST(ibfmin, merge)
+{
+    estimate_ibf_arguments minimiser_ibf_args{};
+    minimiser_arguments minimiser_args{};
+    initialization_args(minimiser_ibf_args);
+    minimiser_ibf_args.path_out = tmp_dir/"IBFMIN_Test_Merge_";
+    std::vector<uint8_t> cutoffs = {0, 0};
+    minimiser({std::string(DATA_INPUT_DIR) + "mini_example.fasta", std::string(DATA_INPUT_DIR) + "mini_example2.fasta"},
+              minimiser_ibf_args, minimiser_args, cutoffs);
+    std::vector<std::filesystem::path> minimiser_files{};
+    for (size_t i = 0; i < 130; i++)
+        minimiser_files.push_back(tmp_dir/((i % 2) ? "IBFMIN_Test_Merge_mini_example2.minimiser" :
+                                                     "IBFMIN_Test_Merge_mini_example.minimiser"));
+    std::vector<std::filesystem::path> first_files(minimiser_files.begin(), minimiser_files.begin() + 70);
+    std::vector<std::filesystem::path> second_files(minimiser_files.begin() + 70, minimiser_files.end());
+    for (auto && [name, files] : std::vector{std::pair{"All", minimiser_files}, std::pair{"First", first_files},
+                                             std::pair{"Second", second_files}})
+    {
+        estimate_ibf_arguments ibf_args{};
+        initialization_args(ibf_args);
+        ibf_args.compressed = false;
+        ibf_args.number_expression_thresholds = 2;
+        ibf_args.path_out = tmp_dir/(std::string{"IBFMIN_Test_"} + name + "_");
+        std::vector<double> fpr = {0.05};
+        ibf(files, ibf_args, fpr);
+    }
+
+    estimate_ibf_arguments merge_args{};
+    merge_args.path_out = tmp_dir/"IBFMIN_Test_Merged_";
+    merge_args.threads = 2;
+    merge_indexes({tmp_dir/"IBFMIN_Test_First_", tmp_dir/"IBFMIN_Test_Second_"}, merge_args);
+
+    for (std::string level : {"0", "1"})
+    {
+        seqan3::interleaved_bloom_filter ibf;
+        seqan3::interleaved_bloom_filter ibf_merged;
+        load_ibf(ibf, tmp_dir/("IBFMIN_Test_All_IBF_Level_" + level));
+        load_ibf(ibf_merged, tmp_dir/("IBFMIN_Test_Merged_IBF_Level_" + level));
+        EXPECT_EQ(130, ibf_merged.bin_count());
+        EXPECT_TRUE(ibf == ibf_merged);
+    }
+
+    std::ifstream levels{tmp_dir/"IBFMIN_Test_All_IBF_Levels.levels"};
+    std::ifstream levels_merged{tmp_dir/"IBFMIN_Test_Merged_IBF_Levels.levels"};
+    std::string line{};
+    std::string line_merged{};
+    while (std::getline(levels, line) && std::getline(levels_merged, line_merged))
+        EXPECT_EQ(line, line_merged);
+    EXPECT_EQ("/", line_merged);
+
+    // Indexes with different expression thresholds can not be merged.
+    estimate_ibf_arguments ibf_args{};
+    initialization_args(ibf_args);
+    ibf_args.compressed = false;
+    ibf_args.expression_thresholds = {1, 2};
+    ibf_args.path_out = tmp_dir/"IBFMIN_Test_Thresholds_";
+    std::vector<double> fpr = {0.05};
+    ibf(first_files, ibf_args, fpr);
+    EXPECT_THROW(merge_indexes({tmp_dir/"IBFMIN_Test_First_", tmp_dir/"IBFMIN_Test_Thresholds_"}, merge_args),
+                 std::invalid_argument);
+
+    for (std::string name : {"All", "First", "Second", "Merged"})
+    {
+        for (std::string level : {"0", "1"})
+            std::filesystem::remove(tmp_dir/("IBFMIN_Test_" + name + "_IBF_Level_" + level));
+        std::filesystem::remove(tmp_dir/("IBFMIN_Test_" + name + "_IBF_Levels.levels"));
+        std::filesystem::remove(tmp_dir/("IBFMIN_Test_" + name + "_IBF_Data"));
+        std::filesystem::remove(tmp_dir/("IBFMIN_Test_" + name + "_IBF_FPRs.fprs"));
+    }
+    std::filesystem::remove(tmp_dir/"IBFMIN_Test_Thresholds_IBF_1");
+    std::filesystem::remove(tmp_dir/"IBFMIN_Test_Thresholds_IBF_2");
+    std::filesystem::remove(tmp_dir/"IBFMIN_Test_Thresholds_IBF_Data");
+    std::filesystem::remove(tmp_dir/"IBFMIN_Test_Thresholds_IBF_FPRs.fprs");
+    std::filesystem::remove(tmp_dir/"IBFMIN_Test_Merge_mini_example.minimiser");
+    std::filesystem::remove(tmp_dir/"IBFMIN_Test_Merge_mini_example2.minimiser");
+}
+
+// Indexes of different experiments have different bin sizes and can only be merged, if they are built with the same
+// given bin sizes.
+TEST(ibfmin, merge_different_files)
+{
+    estimate_ibf_arguments minimiser_ibf_args{};
+    minimiser_arguments minimiser_args{};
+    initialization_args(minimiser_ibf_args);
+    minimiser_ibf_args.path_out = tmp_dir/"IBFMIN_Test_Shards_";
+    std::vector<uint8_t> cutoffs = {0, 0};
+    minimiser({std::string(DATA_INPUT_DIR) + "mini_example.fasta", std::string(DATA_INPUT_DIR) + "mini_example2.fasta"},
+              minimiser_ibf_args, minimiser_args, cutoffs);
+    std::vector<std::filesystem::path> minimiser_files{tmp_dir/"IBFMIN_Test_Shards_mini_example.minimiser",
+                                                       tmp_dir/"IBFMIN_Test_Shards_mini_example2.minimiser"};
+
+    std::vector<uint64_t> bin_sizes{};
+    for (std::string name : {"All", "First", "Second", "First_Pinned", "Second_Pinned"})
+    {
+        estimate_ibf_arguments ibf_args{};
+        initialization_args(ibf_args);
+        // Compressed parts are decompressed for merging.
+        ibf_args.compressed = (name == "Second_Pinned");
+        ibf_args.expression_thresholds = {1, 2};
+        ibf_args.path_out = tmp_dir/("IBFMIN_Test_Shards_" + name + "_");
+        if (name.ends_with("Pinned"))
+            ibf_args.bin_sizes = bin_sizes;
+        std::vector<double> fpr = {0.05};
+        if (name == "All")
+            ibf(minimiser_files, ibf_args, fpr);
+        else
+            ibf({minimiser_files[name.starts_with("First") ? 0 : 1]}, ibf_args, fpr);
+
+        if (name == "All")
+        {
+            for (std::string level : {"1", "2"})
+            {
+                seqan3::interleaved_bloom_filter ibf;
+                load_ibf(ibf, tmp_dir/("IBFMIN_Test_Shards_All_IBF_" + level));
+                bin_sizes.push_back(ibf.bin_size());
+            }
+        }
+    }
+
+    estimate_ibf_arguments merge_args{};
+    merge_args.path_out = tmp_dir/"IBFMIN_Test_Shards_Merged_";
+    merge_indexes({tmp_dir/"IBFMIN_Test_Shards_First_Pinned_", tmp_dir/"IBFMIN_Test_Shards_Second_Pinned_"}, merge_args);
+    // A failing merge keeps the files of the merged index.
+    EXPECT_THROW(merge_indexes({tmp_dir/"IBFMIN_Test_Shards_First_", tmp_dir/"IBFMIN_Test_Shards_Second_"}, merge_args),
+                 std::invalid_argument);
+    EXPECT_FALSE(std::filesystem::exists(tmp_dir/"IBFMIN_Test_Shards_Merged_IBF_1.tmp"));
+
+    for (std::string level : {"1", "2"})
+    {
+        seqan3::interleaved_bloom_filter ibf;
+        seqan3::interleaved_bloom_filter ibf_merged;
+        load_ibf(ibf, tmp_dir/("IBFMIN_Test_Shards_All_IBF_" + level));
+        load_ibf(ibf_merged, tmp_dir/("IBFMIN_Test_Shards_Merged_IBF_" + level));
+        EXPECT_EQ(2, ibf_merged.bin_count());
+        EXPECT_TRUE(ibf == ibf_merged);
+    }
+
+    std::ifstream fprs{tmp_dir/"IBFMIN_Test_Shards_All_IBF_FPRs.fprs"};
+    std::ifstream fprs_merged{tmp_dir/"IBFMIN_Test_Shards_Merged_IBF_FPRs.fprs"};
+    std::string line{};
+    std::string line_merged{};
+    while (std::getline(fprs, line) && std::getline(fprs_merged, line_merged))
+        EXPECT_EQ(line, line_merged);
+    EXPECT_EQ("/", line_merged);
+
+    for (std::string name : {"All", "First", "Second", "First_Pinned", "Second_Pinned", "Merged"})
+    {
+        for (std::string level : {"1", "2"})
+            std::filesystem::remove(tmp_dir/("IBFMIN_Test_Shards_" + name + "_IBF_" + level));
+        std::filesystem::remove(tmp_dir/("IBFMIN_Test_Shards_" + name + "_IBF_Data"));
+        std::filesystem::remove(tmp_dir/("IBFMIN_Test_Shards_" + name + "_IBF_FPRs.fprs"));
+    }
+    for (auto && minimiser_file : minimiser_files)
+        std::filesystem::remove(minimiser_file);
+}
+
+// A single large minimiser file, whose blocks are inserted by several threads.
+TEST(ibfmin, multiple_threads_one_file)
+{
+    std::mt19937_64 rng{42};
+    std::vector<uint64_t> minimisers(5 * minimiser_file_writer::records_per_block);
+    for (auto & minimiser : minimisers)
+        minimiser = rng() & 0xFFFF'FFFF;
+    std::sort(minimisers.begin(), minimisers.end());
+    minimisers.erase(std::unique(minimisers.begin(), minimisers.end()), minimisers.end());
+
+    estimate_ibf_arguments ibf_args{};
+    initialization_args(ibf_args);
+    {
+        minimiser_file_writer outfile{tmp_dir/"IBFMIN_Test_Large.minimiser", minimiser_file_header{ibf_args, 0}};
+        for (auto && minimiser : minimisers)
+            outfile.push(minimiser, 1 + rng() % 8);
+        outfile.close();
+    }
+    std::vector<std::filesystem::path> minimiser_file = {tmp_dir/"IBFMIN_Test_Large.minimiser"};
+
+    for (uint8_t threads : {1, 4})
+    {
+        initialization_args(ibf_args);
+        ibf_args.number_expression_thresholds = 3;
+        ibf_args.expression_thresholds = {};
+        ibf_args.threads = threads;
+        ibf_args.path_out = tmp_dir/("IBFMIN_Test_Large_" + std::to_string(threads) + "_");
+        std::vector<double> fpr = {0.05};
+        ibf(minimiser_file, ibf_args, fpr);
+    }
+
+    for (std::string level : {"0", "1", "2"})
+    {
+        seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed> ibf;
+        seqan3::interleaved_bloom_filter<seqan3::data_layout::compressed> ibf_threads;
+        load_ibf(ibf, tmp_dir/("IBFMIN_Test_Large_1_IBF_Level_" + level));
+        load_ibf(ibf_threads, tmp_dir/("IBFMIN_Test_Large_4_IBF_Level_" + level));
+        EXPECT_TRUE(ibf == ibf_threads);
+    }
+
+    for (std::string threads : {"1", "4"})
+    {
+        for (std::string level : {"0", "1", "2"})
+            std::filesystem::remove(tmp_dir/("IBFMIN_Test_Large_" + threads + "_IBF_Level_" + level));
+        std::filesystem::remove(tmp_dir/("IBFMIN_Test_Large_" + threads + "_IBF_Levels.levels"));
+        std::filesystem::remove(tmp_dir/("IBFMIN_Test_Large_" + threads + "_IBF_Data"));
+        std::filesystem::remove(tmp_dir/("IBFMIN_Test_Large_" + threads + "_IBF_FPRs.fprs"));
+    }
+    std::filesystem::remove(tmp_dir/"IBFMIN_Test_Large.minimiser");
+}
@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+#include <random>
+
+#include "minimiser_file.h"
+
+#ifndef DATA_INPUT_DIR
+#  define DATA_INPUT_DIR @DATA_INPUT_DIR@
+#endif
+
+std::filesystem::path tmp_dir = std::filesystem::temp_directory_path(); // get the temp directory
+
+// Several full blocks and one partial block, with small and large differences between the minimisers.
+TEST(minimiser_file, write_read)
+{
+    std::mt19937_64 rng{42};
+    std::vector<uint64_t> expected_minimisers(3 * minimiser_file_writer::records_per_block + 17);
+    for (auto & minimiser : expected_minimisers)
+        minimiser = rng() >> (rng() % 64);
+    expected_minimisers.push_back(0);
+    expected_minimisers.push_back(std::numeric_limits<uint64_t>::max());
+    std::sort(expected_minimisers.begin(), expected_minimisers.end());
+    expected_minimisers.erase(std::unique(expected_minimisers.begin(), expected_minimisers.end()),
+                              expected_minimisers.end());
+    std::vector<uint16_t> expected_counts(expected_minimisers.size());
+    for (auto & count : expected_counts)
+        count = (rng() % 2) ? rng() % 65535 : rng() % 10;
+
+    min_arguments args{};
+    args.k = 4;
+    args.shape = seqan3::bin_literal{0b1101};
+    args.w_size = seqan3::window_size{8};
+    args.s = seqan3::seed{7};
+    minimiser_file_writer writer{tmp_dir/"Minimiser_File_Test.minimiser", minimiser_file_header{args, 3}};
+    for (size_t i = 0; i < expected_minimisers.size(); ++i)
+        writer.push(expected_minimisers[i], expected_counts[i]);
+    writer.close();
+
+    minimiser_file_reader reader{tmp_dir/"Minimiser_File_Test.minimiser"};
+    EXPECT_EQ(2, reader.header().version);
+    EXPECT_EQ(expected_minimisers.size(), reader.header().number_of_minimisers);
+    EXPECT_EQ(3, reader.header().cutoff);
+    EXPECT_EQ(4, reader.header().k);
+    EXPECT_EQ(8, reader.header().window);
+    EXPECT_EQ(7, reader.header().seed);
+    EXPECT_FALSE(reader.header().ungapped);
+    EXPECT_EQ(0b1101, reader.header().shape);
+
+    std::vector<uint64_t> minimisers{};
+    std::vector<uint16_t> counts{};
+    reader.for_each([&] (uint64_t const minimiser, uint16_t const count)
+    {
+        minimisers.push_back(minimiser);
+        counts.push_back(count);
+    });
+    EXPECT_EQ(expected_minimisers, minimisers);
+    EXPECT_EQ(expected_counts, counts);
+
+    std::vector<uint64_t> expected_histogram(65536, 0);
+    for (uint16_t const count : expected_counts)
+        ++expected_histogram[count];
+    std::vector<uint64_t> histogram{};
+    EXPECT_TRUE(reader.read_histogram(histogram));
+    EXPECT_EQ(expected_histogram, histogram);
+
+    // The blocks can be read in any order.
+    size_t const records_per_block = minimiser_file_writer::records_per_block;
+    EXPECT_EQ((expected_minimisers.size() + records_per_block - 1) / records_per_block, reader.number_of_blocks());
+    minimisers.clear();
+    counts.clear();
+    std::vector<uint64_t> block_minimisers{};
+    std::vector<uint16_t> block_counts{};
+    for (size_t b = reader.number_of_blocks(); b > 0; --b)
+    {
+        reader.read_block(b - 1, block_minimisers, block_counts);
+        minimisers.insert(minimisers.begin(), block_minimisers.begin(), block_minimisers.end());
+        counts.insert(counts.begin(), block_counts.begin(), block_counts.end());
+    }
+    EXPECT_EQ(expected_minimisers, minimisers);
+    EXPECT_EQ(expected_counts, counts);
+
+    std::filesystem::remove(tmp_dir/"Minimiser_File_Test.minimiser");
+}
+
+// The encoded blocks are larger than the buffers, so they are written by several background writes.
+TEST(minimiser_file, several_buffers)
+{
+    size_t const number_of_minimisers = 3 * minimiser_file_writer::buffer_size / 6;
+    min_arguments args{};
+    {
+        minimiser_file_writer writer{tmp_dir/"Minimiser_File_Test_Buffers.minimiser", minimiser_file_header{args, 0}};
+        for (uint64_t i = 0; i < number_of_minimisers; ++i)
+            writer.push(i << 30, i % 300);
+        // The destructor closes the file.
+    }
+
+    minimiser_file_reader reader{tmp_dir/"Minimiser_File_Test_Buffers.minimiser"};
+    EXPECT_EQ(number_of_minimisers, reader.header().number_of_minimisers);
+    EXPECT_GT(std::filesystem::file_size(tmp_dir/"Minimiser_File_Test_Buffers.minimiser"),
+              2 * minimiser_file_writer::buffer_size);
+    uint64_t i{0};
+    bool equal{true};
+    reader.for_each([&] (uint64_t const minimiser, uint16_t const count)
+    {
+        equal &= (minimiser == (i << 30)) && (count == i % 300);
+        ++i;
+    });
+    EXPECT_TRUE(equal);
+    EXPECT_EQ(number_of_minimisers, i);
+    std::filesystem::remove(tmp_dir/"Minimiser_File_Test_Buffers.minimiser");
+}
+
+TEST(minimiser_file, unsorted)
+{
+    min_arguments args{};
+    minimiser_file_writer writer{tmp_dir/"Minimiser_File_Test_Unsorted.minimiser", minimiser_file_header{args, 0}};
+    writer.push(5, 1);
+    EXPECT_THROW(writer.push(5, 1), std::invalid_argument);
+    EXPECT_THROW(writer.push(4, 1), std::invalid_argument);
+    writer.close();
+    std::filesystem::remove(tmp_dir/"Minimiser_File_Test_Unsorted.minimiser");
+}
+
+TEST(minimiser_file, version_1)
+{
+    minimiser_file_reader reader{std::string(DATA_INPUT_DIR) + "mini_example.minimiser"};
+    EXPECT_EQ(1, reader.header().version);
+    EXPECT_EQ(4, reader.header().k);
+    EXPECT_EQ(4, reader.header().window);
+    EXPECT_TRUE(reader.header().ungapped);
+
+    uint64_t number_of_minimisers{0};
+    reader.for_each([&] (uint64_t const, uint16_t const) { ++number_of_minimisers; });
+    EXPECT_EQ(reader.header().number_of_minimisers, number_of_minimisers);
+
+    std::vector<uint64_t> histogram{};
+    EXPECT_FALSE(reader.read_histogram(histogram));
+}
+
+// A file, whose writer is destroyed by an exception before it was closed, can not be read.
+TEST(minimiser_file, incomplete)
+{
+    min_arguments args{};
+    try
+    {
+        minimiser_file_writer writer{tmp_dir/"Minimiser_File_Test_Incomplete.minimiser", minimiser_file_header{args, 0}};
+        for (uint64_t i = 0; i < minimiser_file_writer::buffer_size; ++i)
+            writer.push(i, 1);
+        throw std::runtime_error{"Interrupted."};
+    }
+    catch (std::runtime_error const &)
+    {}
+    EXPECT_THROW(minimiser_file_reader{tmp_dir/"Minimiser_File_Test_Incomplete.minimiser"}, std::runtime_error);
+    std::filesystem::remove(tmp_dir/"Minimiser_File_Test_Incomplete.minimiser");
+}
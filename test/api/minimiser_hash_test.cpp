@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include <iostream>
+#include <random>
+
+#include "minimiser_hash.h"
+
+std::vector<uint64_t> seqan3_minimisers(min_arguments const & args, seqan3::dna4_vector const & seq)
+{
+    std::vector<uint64_t> result{};
+    for (auto && minHash : seqan3::views::minimiser_hash(seq, args.shape, args.w_size, args.s))
+        result.push_back(minHash);
+    return result;
+}
+
+seqan3::dna4_vector random_sequence(std::mt19937_64 & gen, size_t const length, std::string const & alphabet)
+{
+    seqan3::dna4_vector seq{};
+    for (size_t i = 0; i < length; ++i)
+        seq.push_back(seqan3::dna4{}.assign_char(alphabet[gen() % alphabet.size()]));
+    return seq;
+}
+
+// Random sequences, low complexity sequences with many equal values in a window and sequences shorter than the window.
+TEST(minimiser_hash, ungapped_same_as_seqan3)
+{
+    std::mt19937_64 gen{42};
+    std::vector<uint64_t> minimisers{};
+
+    for (uint8_t k : {1, 4, 15, 19, 20, 31, 32})
+    {
+        for (uint32_t w : {0u, 1u, 5u, 40u})
+        {
+            min_arguments args{};
+            args.k = k;
+            args.shape = seqan3::ungapped{k};
+            args.w_size = seqan3::window_size{k + w};
+            args.s = seqan3::seed{adjust_seed(k)};
+
+            for (std::string alphabet : {"ACGT", "AC", "A"})
+            {
+                for (size_t length : {0, 3, 30, 60, 500})
+                {
+                    seqan3::dna4_vector seq = random_sequence(gen, length, alphabet);
+                    compute_minimisers(args, seq, minimisers);
+                    EXPECT_EQ(seqan3_minimisers(args, seq), minimisers);
+                }
+            }
+        }
+    }
+}
+
+TEST(minimiser_hash, gapped_same_as_seqan3)
+{
+    std::mt19937_64 gen{42};
+    std::vector<uint64_t> minimisers{};
+    min_arguments args{};
+    args.k = 4;
+    args.shape = seqan3::bin_literal{0b1101};
+    args.w_size = seqan3::window_size{8};
+    args.s = seqan3::seed{0};
+
+    seqan3::dna4_vector seq = random_sequence(gen, 200, "ACGT");
+    compute_minimisers(args, seq, minimisers);
+    EXPECT_EQ(seqan3_minimisers(args, seq), minimisers);
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <random>
+#include <unordered_set>
+
+#include "minimiser_set.h"
+
+std::filesystem::path tmp_dir = std::filesystem::temp_directory_path(); // get the temp directory
+
+TEST(minimiser_set, empty)
+{
+    minimiser_set set{};
+    EXPECT_TRUE(set.empty());
+    EXPECT_FALSE(set.contains(0));
+
+    std::vector<uint64_t> minimisers{1, 2, 3};
+    set.filter(minimisers, false);
+    EXPECT_EQ((std::vector<uint64_t>{1, 2, 3}), minimisers);
+    set.filter(minimisers, true);
+    EXPECT_TRUE(minimisers.empty());
+}
+
+TEST(minimiser_set, random)
+{
+    std::mt19937_64 rng{42};
+    std::vector<uint64_t> values(20000);
+    for (auto & value : values)
+        value = rng();
+    values.push_back(0);
+    values.push_back(std::numeric_limits<uint64_t>::max());
+    values.push_back(values[5]); // duplicate
+    std::unordered_set<uint64_t> expected(values.begin(), values.end());
+
+    minimiser_set set{values};
+    EXPECT_EQ(expected.size(), set.size());
+    EXPECT_TRUE(std::is_sorted(set.begin(), set.end()));
+
+    std::vector<uint64_t> queries(values.begin(), values.begin() + 1000);
+    for (size_t i = 0; i < 1000; ++i)
+        queries.push_back(rng() >> (i % 64));
+    for (uint64_t const query : queries)
+        EXPECT_EQ(expected.contains(query), set.contains(query));
+
+    std::vector<uint64_t> kept = queries;
+    std::vector<uint64_t> removed = queries;
+    set.filter(kept, true);
+    set.filter(removed, false);
+    EXPECT_EQ(queries.size(), kept.size() + removed.size());
+    for (uint64_t const query : kept)
+        EXPECT_TRUE(expected.contains(query));
+    for (uint64_t const query : removed)
+        EXPECT_FALSE(expected.contains(query));
+}
+
+// Few minimisers with the highest bit set, as hashes of k = 32 can be.
+TEST(minimiser_set, high_bit)
+{
+    std::vector<uint64_t> const values{5, 1ULL << 63, std::numeric_limits<uint64_t>::max()};
+    minimiser_set set{values};
+    EXPECT_EQ(values.size(), set.size());
+    for (uint64_t const value : values)
+        EXPECT_TRUE(set.contains(value));
+    EXPECT_FALSE(set.contains(6));
+    EXPECT_FALSE(set.contains((1ULL << 63) + 1));
+
+    std::vector<uint64_t> minimisers{1ULL << 63, 6, 5, (1ULL << 63) - 1};
+    set.filter(minimisers, true);
+    EXPECT_EQ((std::vector<uint64_t>{1ULL << 63, 5}), minimisers);
+}
+
+TEST(minimiser_set, mapped_file)
+{
+    std::vector<uint64_t> const values{3, 17, 1000, 1ULL << 40};
+    std::filesystem::path const path{tmp_dir/"Minimiser_Set_Test.bin"};
+    {
+        std::ofstream outfile{path, std::ios::binary};
+        uint64_t const header{values.size()};
+        outfile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        outfile.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(uint64_t));
+    }
+
+    minimiser_set set{mapped_file{path}, sizeof(uint64_t), values.size()};
+    EXPECT_EQ(values.size(), set.size());
+    EXPECT_TRUE(std::equal(set.begin(), set.end(), values.begin(), values.end()));
+    for (uint64_t const value : values)
+        EXPECT_TRUE(set.contains(value));
+    EXPECT_FALSE(set.contains(18));
+    std::filesystem::remove(path);
+}
@@ -51,6 +51,17 @@ void initialization_args(estimate_ibf_arguments & args)
     args.compressed = true;
 }
 
+// Sequence files given as include, exclude or genome file are copied into a temporary directory, so the caches of their
+// minimisers, which are stored next to them, are not written into the test data.
+std::filesystem::path data_copy(std::string const & filename)
+{
+    std::filesystem::path const data_dir = std::filesystem::temp_directory_path()/"Minimiser_Test_Data";
+    std::filesystem::create_directories(data_dir);
+    std::filesystem::copy_file(std::string(DATA_INPUT_DIR) + filename, data_dir/filename,
+                               std::filesystem::copy_options::skip_existing);
+    return data_dir/filename;
+}
+
 TEST(minimiser, small_example)
 {
     estimate_ibf_arguments args{};
@@ -63,7 +74,7 @@ TEST(minimiser, small_example)
                                                          std::string(DATA_INPUT_DIR) + "mini_example2.fasta"};
     minimiser(sequence_files, args, minimiser_args, cutoffs);
     uint32_t normalized_exp_value{};
-    robin_hood::unordered_node_map<uint64_t, uint16_t> result_hash_table{};
+    flat_counter_table<uint16_t> result_hash_table{};
     std::vector<std::filesystem::path> minimiser_files{};
     uint64_t num_of_minimisers{};
     std::vector<uint64_t> expected_nums{12, 12};
@@ -162,7 +173,7 @@ TEST(minimiser, small_example_samplewise)
     uint32_t normalized_exp_value{};
     std::vector<std::vector<uint32_t>> expected_counts{{7}, {12}};
     std::vector<uint16_t> expected_levels{};
-    robin_hood::unordered_node_map<uint64_t, uint16_t> result_hash_table{};
+    flat_counter_table<uint16_t> result_hash_table{};
     std::vector<std::filesystem::path> minimiser_files{};
     uint64_t num_of_minimisers{};
     std::vector<uint64_t> expected_nums{12, 12};
@@ -284,7 +295,7 @@ TEST(minimiser, small_example_two_threads)
     minimiser(sequence_files, args, minimiser_args, cutoffs);
     args.threads = 1;
     uint32_t normalized_exp_value{};
-    robin_hood::unordered_node_map<uint64_t, uint16_t> result_hash_table{};
+    flat_counter_table<uint16_t> result_hash_table{};
     std::vector<std::filesystem::path> minimiser_files{};
     uint64_t num_of_minimisers{};
     std::vector<uint64_t> expected_nums{12, 12};
@@ -336,6 +347,213 @@ TEST(minimiser, small_example_two_threads)
     std::filesystem::remove(tmp_dir/("Minimiser_Test_mini_example2.minimiser"));
 }
 
+// More threads than samples, so the reads of each sample are distributed over all threads.
+TEST(minimiser, small_example_more_threads_than_samples)
+{
+    estimate_ibf_arguments args{};
+    minimiser_arguments minimiser_args{};
+    initialization_args(args);
+    args.threads = 4;
+    args.path_out = tmp_dir/"Minimiser_Test_Threads_";
+    std::vector<uint8_t> cutoffs = {0, 0};
+    std::vector<std::filesystem::path> sequence_files = {std::string(DATA_INPUT_DIR) + "mini_example.fasta",
+                                                         std::string(DATA_INPUT_DIR) + "mini_example2.fasta"};
+    minimiser(sequence_files, args, minimiser_args, cutoffs);
+    args.threads = 1;
+    flat_counter_table<uint16_t> result_hash_table{};
+    uint64_t num_of_minimisers{};
+    std::vector<uint64_t> expected_nums{12, 12};
+
+    for (int i = 0; i < sequence_files.size(); ++i)
+    {
+        uint8_t cutoff{};
+        // Test Header file
+        read_binary_start(args, tmp_dir/("Minimiser_Test_Threads_" + std::string{sequence_files[i].stem()} + ".minimiser"), num_of_minimisers, cutoff);
+
+        EXPECT_EQ(4, args.k);
+        EXPECT_EQ(0, cutoff);
+        EXPECT_EQ(expected_nums[i], num_of_minimisers);
+
+        // Test binary file
+        read_binary(tmp_dir/("Minimiser_Test_Threads_" + std::string{sequence_files[i].stem()} + ".minimiser"), result_hash_table);
+        for (auto & hash : expected_hash_tables[i])
+        {
+            EXPECT_EQ(expected_hash_tables[i][hash.first], result_hash_table[hash.first]);
+        }
+
+        result_hash_table.clear();
+    }
+
+    std::filesystem::remove(tmp_dir/("Minimiser_Test_Threads_mini_example.minimiser"));
+    std::filesystem::remove(tmp_dir/("Minimiser_Test_Threads_mini_example2.minimiser"));
+}
+
+// Both mates are read at the same time, the counts are the sum of the counts of both files.
+TEST(minimiser, small_example_paired_threads)
+{
+    estimate_ibf_arguments args{};
+    minimiser_arguments minimiser_args{};
+    initialization_args(args);
+    args.threads = 4;
+    args.path_out = tmp_dir/"Minimiser_Test_Paired_";
+    minimiser_args.paired = true;
+    std::vector<uint8_t> cutoffs = {0};
+    std::vector<std::filesystem::path> sequence_files = {std::string(DATA_INPUT_DIR) + "mini_example.fasta",
+                                                         std::string(DATA_INPUT_DIR) + "mini_example2.fasta"};
+    minimiser(sequence_files, args, minimiser_args, cutoffs);
+
+    robin_hood::unordered_node_map<uint64_t, uint16_t> expected_hash_table{expected_hash_tables[0]};
+    for (auto & hash : expected_hash_tables[1])
+        expected_hash_table[hash.first] += hash.second;
+
+    flat_counter_table<uint16_t> result_hash_table{};
+    uint64_t num_of_minimisers{};
+    uint8_t cutoff{};
+    read_binary_start(args, tmp_dir/"Minimiser_Test_Paired_mini_example.minimiser", num_of_minimisers, cutoff);
+    EXPECT_EQ(expected_hash_table.size(), num_of_minimisers);
+    read_binary(tmp_dir/"Minimiser_Test_Paired_mini_example.minimiser", result_hash_table);
+    EXPECT_EQ(expected_hash_table.size(), result_hash_table.size());
+    for (auto & hash : expected_hash_table)
+        EXPECT_EQ(hash.second, result_hash_table[hash.first]);
+
+    std::filesystem::remove(tmp_dir/"Minimiser_Test_Paired_mini_example.minimiser");
+}
+
+TEST(minimiser, merge)
+{
+    estimate_ibf_arguments args{};
+    minimiser_arguments minimiser_args{};
+    initialization_args(args);
+    args.path_out = tmp_dir/"Minimiser_Test_Merge_";
+    std::vector<uint8_t> cutoffs = {0, 0};
+    std::vector<std::filesystem::path> sequence_files = {std::string(DATA_INPUT_DIR) + "mini_example.fasta",
+                                                         std::string(DATA_INPUT_DIR) + "mini_example2.fasta"};
+    minimiser(sequence_files, args, minimiser_args, cutoffs);
+    std::vector<std::filesystem::path> minimiser_files = {tmp_dir/"Minimiser_Test_Merge_mini_example.minimiser",
+                                                          tmp_dir/"Minimiser_Test_Merge_mini_example2.minimiser"};
+
+    robin_hood::unordered_node_map<uint64_t, uint16_t> expected_hash_table{expected_hash_tables[0]};
+    for (auto & hash : expected_hash_tables[1])
+        expected_hash_table[hash.first] += hash.second;
+
+    for (uint8_t merge_cutoff : {0, 1})
+    {
+        minimiser_merge(minimiser_files, tmp_dir/"Minimiser_Test_Merged.minimiser", merge_cutoff);
+
+        flat_counter_table<uint16_t> result_hash_table{};
+        uint64_t num_of_minimisers{};
+        uint8_t cutoff{};
+        read_binary_start(args, tmp_dir/"Minimiser_Test_Merged.minimiser", num_of_minimisers, cutoff);
+        EXPECT_EQ(merge_cutoff, cutoff);
+        read_binary(tmp_dir/"Minimiser_Test_Merged.minimiser", result_hash_table);
+        EXPECT_EQ(num_of_minimisers, result_hash_table.size());
+        for (auto & hash : expected_hash_table)
+        {
+            if (hash.second > merge_cutoff)
+                EXPECT_EQ(hash.second, result_hash_table[hash.first]);
+            else
+                EXPECT_EQ(0, result_hash_table[hash.first]);
+        }
+    }
+
+    // The output file can be one of the merged files.
+    minimiser_merge(minimiser_files, minimiser_files[0]);
+    flat_counter_table<uint16_t> result_hash_table{};
+    read_binary(minimiser_files[0], result_hash_table);
+    EXPECT_EQ(expected_hash_table.size(), result_hash_table.size());
+    for (auto & hash : expected_hash_table)
+        EXPECT_EQ(hash.second, result_hash_table[hash.first]);
+    EXPECT_FALSE(std::filesystem::exists(minimiser_files[0].string() + ".tmp"));
+
+    // Minimiser files with different minimiser arguments can not be merged.
+    args.w_size = seqan3::window_size{5};
+    args.path_out = tmp_dir/"Minimiser_Test_Merge_W5_";
+    minimiser_arguments other_minimiser_args{};
+    sequence_files.pop_back();
+    cutoffs.pop_back();
+    minimiser(sequence_files, args, other_minimiser_args, cutoffs);
+    minimiser_files.push_back(tmp_dir/"Minimiser_Test_Merge_W5_mini_example.minimiser");
+    EXPECT_THROW(minimiser_merge(minimiser_files, tmp_dir/"Minimiser_Test_Merged.minimiser"), std::invalid_argument);
+
+    for (auto & file : minimiser_files)
+        std::filesystem::remove(file);
+    std::filesystem::remove(tmp_dir/"Minimiser_Test_Merged.minimiser");
+}
+
+// With cutoff 0 every minimiser passes the sketch on its first occurrence, so the counts are exact.
+TEST(minimiser, small_example_sketch)
+{
+    estimate_ibf_arguments args{};
+    minimiser_arguments minimiser_args{};
+    initialization_args(args);
+    minimiser_args.sketch_memory = 1;
+    args.path_out = tmp_dir/"Minimiser_Test_Sketch_";
+    std::vector<uint8_t> cutoffs = {0, 0};
+    std::vector<std::filesystem::path> sequence_files = {std::string(DATA_INPUT_DIR) + "mini_example.fasta",
+                                                         std::string(DATA_INPUT_DIR) + "mini_example2.fasta"};
+    minimiser(sequence_files, args, minimiser_args, cutoffs);
+    flat_counter_table<uint16_t> result_hash_table{};
+    uint64_t num_of_minimisers{};
+    std::vector<uint64_t> expected_nums{12, 12};
+
+    for (int i = 0; i < sequence_files.size(); ++i)
+    {
+        uint8_t cutoff{};
+        read_binary_start(args, tmp_dir/("Minimiser_Test_Sketch_" + std::string{sequence_files[i].stem()} + ".minimiser"), num_of_minimisers, cutoff);
+        EXPECT_EQ(expected_nums[i], num_of_minimisers);
+
+        read_binary(tmp_dir/("Minimiser_Test_Sketch_" + std::string{sequence_files[i].stem()} + ".minimiser"), result_hash_table);
+        for (auto & hash : expected_hash_tables[i])
+        {
+            EXPECT_EQ(expected_hash_tables[i][hash.first], result_hash_table[hash.first]);
+        }
+
+        result_hash_table.clear();
+    }
+
+    std::filesystem::remove(tmp_dir/("Minimiser_Test_Sketch_mini_example.minimiser"));
+    std::filesystem::remove(tmp_dir/("Minimiser_Test_Sketch_mini_example2.minimiser"));
+}
+
+TEST(minimiser, small_example_max_memory)
+{
+    estimate_ibf_arguments args{};
+    minimiser_arguments minimiser_args{};
+    initialization_args(args);
+    minimiser_args.max_memory = 1;
+    args.path_out = tmp_dir/"Minimiser_Test_Memory_";
+    std::vector<uint8_t> cutoffs = {0, 0};
+    std::vector<std::filesystem::path> sequence_files = {std::string(DATA_INPUT_DIR) + "mini_example.fasta",
+                                                         std::string(DATA_INPUT_DIR) + "mini_example2.fasta"};
+    minimiser(sequence_files, args, minimiser_args, cutoffs);
+    flat_counter_table<uint16_t> result_hash_table{};
+    uint64_t num_of_minimisers{};
+    std::vector<uint64_t> expected_nums{12, 12};
+
+    for (int i = 0; i < sequence_files.size(); ++i)
+    {
+        uint8_t cutoff{};
+        read_binary_start(args, tmp_dir/("Minimiser_Test_Memory_" + std::string{sequence_files[i].stem()} + ".minimiser"), num_of_minimisers, cutoff);
+        EXPECT_EQ(4, args.k);
+        EXPECT_EQ(0, cutoff);
+        EXPECT_EQ(expected_nums[i], num_of_minimisers);
+
+        read_binary(tmp_dir/("Minimiser_Test_Memory_" + std::string{sequence_files[i].stem()} + ".minimiser"), result_hash_table);
+        EXPECT_EQ(expected_nums[i], result_hash_table.size());
+        for (auto & hash : expected_hash_tables[i])
+        {
+            EXPECT_EQ(expected_hash_tables[i][hash.first], result_hash_table[hash.first]);
+        }
+
+        result_hash_table.clear();
+        // Temporary files are removed.
+        EXPECT_FALSE(std::filesystem::exists(tmp_dir/("Minimiser_Test_Memory_" + std::string{sequence_files[i].stem()} + ".bucket_0")));
+    }
+
+    std::filesystem::remove(tmp_dir/("Minimiser_Test_Memory_mini_example.minimiser"));
+    std::filesystem::remove(tmp_dir/("Minimiser_Test_Memory_mini_example2.minimiser"));
+}
+
 TEST(minimiser, small_example_include)
 {
     estimate_ibf_arguments args{};
@@ -343,12 +561,12 @@ TEST(minimiser, small_example_include)
     initialization_args(args);
     args.path_out = tmp_dir/"Minimiser_Test_In_";
     std::vector<uint8_t> cutoffs = {0, 0};
-    minimiser_args.include_file = std::string(DATA_INPUT_DIR) + "mini_gen.fasta";
+    minimiser_args.include_file = data_copy("mini_gen.fasta");
     std::vector<std::filesystem::path> sequence_files = {std::string(DATA_INPUT_DIR) + "mini_example.fasta",
                                                          std::string(DATA_INPUT_DIR) + "mini_example2.fasta"};
     minimiser(sequence_files, args, minimiser_args, cutoffs);
     uint32_t normalized_exp_value{};
-    robin_hood::unordered_node_map<uint64_t, uint16_t> result_hash_table{};
+    flat_counter_table<uint16_t> result_hash_table{};
     std::vector<std::filesystem::path> minimiser_files{};
     uint64_t num_of_minimisers{};
     std::vector<uint64_t> expected_nums{1, 0};
@@ -371,7 +589,7 @@ TEST(minimiser, small_example_include)
         minimiser_files.push_back(tmp_dir/("Minimiser_Test_In_" + std::string{sequence_files[i].stem()} + ".minimiser"));
         if (i==0)
         {
-            for (auto & hash : result_hash_table)
+            for (auto && hash : result_hash_table)
             {
                 EXPECT_EQ(192, hash.first); // 192 minimiser TAAA, only minimiser in mini_gen
                 EXPECT_EQ(3, result_hash_table[hash.first]);
@@ -387,6 +605,40 @@ TEST(minimiser, small_example_include)
 
     std::filesystem::remove(tmp_dir/("Minimiser_Test_In_mini_example.minimiser"));
     std::filesystem::remove(tmp_dir/("Minimiser_Test_In_mini_example2.minimiser"));
+    std::filesystem::remove_all(std::filesystem::temp_directory_path()/"Minimiser_Test_Data");
+}
+
+// The minimisers of the include file are cached next to it. The second run with another output reads the cache instead
+// of writing a new one.
+TEST(minimiser, small_example_include_cache)
+{
+    estimate_ibf_arguments args{};
+    minimiser_arguments minimiser_args{};
+    initialization_args(args);
+    std::vector<uint8_t> cutoffs = {0};
+    minimiser_args.include_file = data_copy("mini_gen.fasta");
+    std::filesystem::path const cache = minimiser_args.include_file.string() + ".k4_w4_s0_15.minimisers";
+    std::vector<std::filesystem::path> sequence_files = {std::string(DATA_INPUT_DIR) + "mini_example.fasta"};
+
+    std::filesystem::file_time_type cache_time{};
+    for (std::string run : {"1", "2"})
+    {
+        args.path_out = tmp_dir/("Minimiser_Test_Cache_" + run + "_");
+        minimiser(sequence_files, args, minimiser_args, cutoffs);
+        EXPECT_TRUE(std::filesystem::exists(cache));
+        EXPECT_FALSE(std::filesystem::exists(args.path_out.string() + "mini_gen.fasta.k4_w4_s0_15.minimisers"));
+        if (run == "1")
+            cache_time = std::filesystem::last_write_time(cache);
+        EXPECT_EQ(cache_time, std::filesystem::last_write_time(cache));
+
+        flat_counter_table<uint16_t> result_hash_table{};
+        read_binary(args.path_out.string() + "mini_example.minimiser", result_hash_table);
+        EXPECT_EQ(1, result_hash_table.size());
+        EXPECT_EQ(3, result_hash_table[192]); // 192 minimiser TAAA, only minimiser in mini_gen
+        std::filesystem::remove(args.path_out.string() + "mini_example.minimiser");
+    }
+
+    std::filesystem::remove_all(std::filesystem::temp_directory_path()/"Minimiser_Test_Data");
 }
 
 TEST(minimiser, small_example_exclude)
@@ -396,14 +648,14 @@ TEST(minimiser, small_example_exclude)
     initialization_args(args);
     args.path_out = tmp_dir/"Minimiser_Test_Ex_";
     std::vector<uint8_t> cutoffs = {0, 0};
-    minimiser_args.exclude_file = std::string(DATA_INPUT_DIR) + "mini_gen2.fasta";
+    minimiser_args.exclude_file = data_copy("mini_gen2.fasta");
     args.expression_thresholds = {0};
     std::vector<double> fpr = {0.05};
     std::vector<std::filesystem::path> sequence_files = {std::string(DATA_INPUT_DIR) + "mini_example.fasta",
                                                          std::string(DATA_INPUT_DIR) + "mini_example2.fasta"};
     minimiser(sequence_files, args, minimiser_args, cutoffs);
     uint32_t normalized_exp_value{};
-    robin_hood::unordered_node_map<uint64_t, uint16_t> result_hash_table{};
+    flat_counter_table<uint16_t> result_hash_table{};
     std::vector<std::filesystem::path> minimiser_files{};
     uint64_t num_of_minimisers{};
     std::vector<uint64_t> expected_nums{11, 12};
@@ -456,6 +708,7 @@ TEST(minimiser, small_example_exclude)
     std::filesystem::remove(tmp_dir/"Minimiser_Test_Ex_IBF_FPRs.fprs");
     std::filesystem::remove(tmp_dir/("Minimiser_Test_Ex_mini_example.minimiser"));
     std::filesystem::remove(tmp_dir/("Minimiser_Test_Ex_mini_example2.minimiser"));
+    std::filesystem::remove_all(std::filesystem::temp_directory_path()/"Minimiser_Test_Data");
 }
 
 TEST(minimiser, small_example_shape)
@@ -492,7 +745,7 @@ TEST(minimiser, small_example_shape)
                                                          std::string(DATA_INPUT_DIR) + "mini_example2.fasta"};
     minimiser(sequence_files, args, minimiser_args, cutoffs);
     uint32_t normalized_exp_value{};
-    robin_hood::unordered_node_map<uint64_t, uint16_t> result_hash_table{};
+    flat_counter_table<uint16_t> result_hash_table{};
     std::vector<std::filesystem::path> minimiser_files{};
     uint64_t num_of_minimisers{};
     std::vector<uint64_t> expected_nums{8, 7};
@@ -0,0 +1,41 @@
+#include <string>                // strings
+
+#include "cli_test.hpp"
+
+struct minimiser_merge_options_test : public cli_test {};
+
+TEST_F(minimiser_merge_options_test, no_options)
+{
+    cli_test_result result = execute_app("needle minimiser-merge");
+    std::string expected
+    {
+        "needle-minimiser-merge - Merges minimiser files of the same experiment into one minimiser file.\n"
+        "===============================================================================================\n"
+        "    Try -h or --help for more information.\n"
+    };
+    EXPECT_EQ(result.exit_code, 0);
+    EXPECT_EQ(result.out, expected);
+    EXPECT_EQ(result.err, std::string{});
+}
+
+TEST_F(minimiser_merge_options_test, fail_no_argument)
+{
+    cli_test_result result = execute_app("needle minimiser-merge", "--cutoff 2");
+    std::string expected
+    {
+        "Error. Incorrect command line input for minimiser-merge. Not enough positional arguments provided "
+        "(Need at least 1). See -h/--help for more information.\n"
+    };
+    EXPECT_EQ(result.exit_code, 0);
+    EXPECT_EQ(result.out, std::string{});
+    EXPECT_EQ(result.err, expected);
+}
+
+TEST_F(minimiser_merge_options_test, with_arguments)
+{
+    cli_test_result result = execute_app("needle minimiser-merge --cutoff 2 -o merged.minimiser",
+                                         data("mini_example.minimiser"), data("mini_example.minimiser"));
+    EXPECT_EQ(result.exit_code, 0);
+    EXPECT_EQ(result.out, "");
+    EXPECT_EQ(result.err, std::string{});
+}